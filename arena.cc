@@ -0,0 +1,43 @@
+#include "arena.h"
+
+#include <cstdint>
+#include <sys/mman.h>
+#include <unistd.h>
+
+Arena::Arena(size_t block_bytes) : kBlockBytes(block_bytes) {}
+
+Arena::~Arena() {
+  for (const auto &block : blocks_)
+    munmap(block.first, block.second);
+}
+
+char *Arena::MapBlock(size_t bytes) {
+  const size_t page = sysconf(_SC_PAGESIZE);
+  bytes = (bytes + page - 1) / page * page;
+  // the pages are only backed by memory once they are touched
+  void *block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (block == MAP_FAILED)
+    throw bad_alloc();
+  blocks_.emplace_back(static_cast<char *>(block), bytes);
+  mapped_bytes_ += bytes;
+  return static_cast<char *>(block);
+}
+
+void *Arena::Allocate(size_t bytes, size_t alignment) {
+  allocated_bytes_ += bytes;
+  // a large allocation gets its own block, so the rest of the current block
+  // isn't wasted
+  if (bytes > kBlockBytes / 4)
+    return MapBlock(bytes);
+
+  uintptr_t p = reinterpret_cast<uintptr_t>(next_);
+  p = (p + alignment - 1) & ~(uintptr_t)(alignment - 1);
+  if (next_ == nullptr || p + bytes > reinterpret_cast<uintptr_t>(limit_)) {
+    next_ = MapBlock(kBlockBytes);
+    limit_ = next_ + kBlockBytes;
+    p = reinterpret_cast<uintptr_t>(next_);
+  }
+  next_ = reinterpret_cast<char *>(p + bytes);
+  return reinterpret_cast<void *>(p);
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// A monotonic allocator for the containers of one data set. Allocate() bumps
+// a pointer through blocks mapped with mmap, memory is never given back
+// before the arena is destroyed, which unmaps every block at once. The hash
+// table nodes, bucket arrays and postings are then not freed one by one.
+//
+// Only the containers allocate from it. The buffers of the std::string keys,
+// values and deltas in them stay on the heap, so destroying the containers
+// still walks every node and frees those strings one by one; teardown is not
+// just the munmap calls.
+//
+// Not thread safe, like the containers it backs. Memory of erased elements
+// and of rehashed bucket arrays stays in the arena until the end.
+class Arena {
+public:
+  explicit Arena(size_t block_bytes = kDefaultBlockBytes);
+  ~Arena();
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  // alignment must be a power of two, at most the page size
+  void *Allocate(size_t bytes, size_t alignment);
+
+  // bytes of all mapped blocks, and of the allocations in them
+  size_t MappedBytes() const { return mapped_bytes_; }
+  size_t AllocatedBytes() const { return allocated_bytes_; }
+  size_t Blocks() const { return blocks_.size(); }
+
+  static const size_t kDefaultBlockBytes = 64 << 20;
+
+private:
+  // a new block of at least bytes, rounded up to pages
+  char *MapBlock(size_t bytes);
+
+  const size_t kBlockBytes;
+  vector<pair<char *, size_t>> blocks_;
+  char *next_ = nullptr;
+  char *limit_ = nullptr;
+  size_t mapped_bytes_ = 0;
+  size_t allocated_bytes_ = 0;
+};
+
+// The standard allocator interface over an Arena. Without an arena it
+// allocates with operator new like std::allocator, so the same container
+// types run with and without an arena, see --no-arena.
+template <typename T> class ArenaAllocator {
+public:
+  typedef T value_type;
+  // the allocator moves and swaps with the elements, never copies them into
+  // another arena
+  typedef true_type propagate_on_container_copy_assignment;
+  typedef true_type propagate_on_container_move_assignment;
+  typedef true_type propagate_on_container_swap;
+
+  explicit ArenaAllocator(Arena *arena = nullptr) : arena_(arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &other) : arena_(other.GetArena()) {}
+
+  T *allocate(size_t n) {
+    if (arena_ == nullptr)
+      return static_cast<T *>(::operator new(n * sizeof(T)));
+    return static_cast<T *>(arena_->Allocate(n * sizeof(T), alignof(T)));
+  }
+  void deallocate(T *p, size_t) {
+    if (arena_ == nullptr)
+      ::operator delete(p);
+  }
+
+  Arena *GetArena() const { return arena_; }
+
+private:
+  Arena *arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+  return a.GetArena() == b.GetArena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+  return !(a == b);
+}
+
+template <typename K, typename V>
+using ArenaHashMap = unordered_map<K, V, hash<K>, equal_to<K>,
+                                   ArenaAllocator<pair<const K, V>>>;
+template <typename T>
+using ArenaHashSet =
+    unordered_set<T, hash<T>, equal_to<T>, ArenaAllocator<T>>;
+template <typename K, typename V>
+using ArenaMap = map<K, V, less<K>, ArenaAllocator<pair<const K, V>>>;
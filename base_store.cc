@@ -0,0 +1,134 @@
+#include "base_store.h"
+
+#include <boost/filesystem.hpp>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = boost::filesystem;
+
+bool MemoryBaseStore::Put(const string &key, const string &value) {
+  values_[key] = value;
+  return true;
+}
+
+bool MemoryBaseStore::Get(const string &key, string *value) const {
+  auto it = values_.find(key);
+  if (it == values_.end())
+    return false;
+  *value = it->second;
+  return true;
+}
+
+FileBaseStore::~FileBaseStore() {
+  if (fd_ >= 0)
+    close(fd_);
+  if (!directory_.empty()) {
+    boost::system::error_code error;
+    fs::remove_all(directory_, error);
+  }
+}
+
+bool FileBaseStore::Open(const string &directory) {
+  string pattern = directory + "/deltabench.XXXXXX";
+  if (mkdtemp(&pattern[0]) == nullptr) {
+    perror(("can't create a directory under " + directory).c_str());
+    return false;
+  }
+  directory_ = pattern;
+  const string path = directory_ + "/bases";
+  fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    perror(("can't create " + path).c_str());
+    return false;
+  }
+  return true;
+}
+
+bool FileBaseStore::Put(const string &key, const string &value) {
+  size_t written = 0;
+  while (written < value.size()) {
+    ssize_t n = pwrite(fd_, value.data() + written, value.size() - written,
+                       file_size_ + written);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      perror("can't write the base store");
+      return false;
+    }
+    written += n;
+  }
+  locations_[key] = make_pair(file_size_, value.size());
+  file_size_ += value.size();
+  return true;
+}
+
+bool FileBaseStore::Get(const string &key, string *value) const {
+  auto it = locations_.find(key);
+  if (it == locations_.end())
+    return false;
+  value->resize(it->second.second);
+  size_t read = 0;
+  while (read < value->size()) {
+    ssize_t n = pread(fd_, &(*value)[read], value->size() - read,
+                      it->second.first + read);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    read += n;
+  }
+  return true;
+}
+
+unique_ptr<BaseStore> NewBaseStore(BaseStoreType type,
+                                   const string &directory) {
+  if (type == kFileBaseStore) {
+    FileBaseStore *store = new FileBaseStore();
+    unique_ptr<BaseStore> owner(store);
+    if (!store->Open(directory))
+      return nullptr;
+    return owner;
+  }
+  return unique_ptr<BaseStore>(new MemoryBaseStore());
+}
+
+BaseCache::BaseCache(const BaseStore &store, size_t capacity)
+    : store_(store), kCapacity(capacity) {}
+
+shared_ptr<const string> BaseCache::Get(const string &key) {
+  {
+    lock_guard<mutex> lock(mutex_);
+    auto it = positions_.find(key);
+    if (it != positions_.end()) {
+      ++hits_;
+      entries_.splice(entries_.begin(), entries_, it->second);
+      return it->second->second;
+    }
+    ++misses_;
+  }
+
+  // fetch without the lock, so the other threads keep hitting the cache
+  shared_ptr<string> value = make_shared<string>();
+  if (!store_.Get(key, value.get()))
+    return nullptr;
+  if (value->size() > kCapacity)
+    return value;
+
+  lock_guard<mutex> lock(mutex_);
+  if (positions_.count(key))
+    return value;
+  entries_.emplace_front(key, value);
+  positions_[key] = entries_.begin();
+  bytes_ += value->size();
+  while (bytes_ > kCapacity) {
+    const Entry &last = entries_.back();
+    bytes_ -= last.second->size();
+    positions_.erase(last.first);
+    entries_.pop_back();
+    ++evictions_;
+  }
+  return value;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+enum BaseStoreType : uint8_t {
+  kMemoryBaseStore, // a copy of the bases in a hash map
+  kFileBaseStore,   // the bases appended to a local file, read with pread
+  kNumberOfBaseStore
+};
+
+const static string base_store_name[kNumberOfBaseStore]{"memory", "file"};
+
+inline string ToString(BaseStoreType type) { return base_store_name[type]; }
+
+// Where the decode path fetches the base of a delta from, as a store would
+// read it from its disk. Get may be called from several threads once all
+// bases are put.
+class BaseStore {
+public:
+  virtual ~BaseStore() {}
+
+  virtual bool Put(const string &key, const string &value) = 0;
+  // Returns false if key is not stored or can't be read
+  virtual bool Get(const string &key, string *value) const = 0;
+};
+
+class MemoryBaseStore : public BaseStore {
+public:
+  bool Put(const string &key, const string &value) override;
+  bool Get(const string &key, string *value) const override;
+
+private:
+  unordered_map<string, string> values_;
+};
+
+// All values in one file of a new directory under the given one, which is
+// removed with the store
+class FileBaseStore : public BaseStore {
+public:
+  ~FileBaseStore();
+
+  // Returns false and prints the reason if the file can't be created
+  bool Open(const string &directory);
+  bool Put(const string &key, const string &value) override;
+  bool Get(const string &key, string *value) const override;
+
+private:
+  int fd_ = -1;
+  string directory_;
+  uint64_t file_size_ = 0;
+  // offset and length of every value
+  unordered_map<string, pair<uint64_t, size_t>> locations_;
+};
+
+// nullptr if the store can't be created, the file store is created under
+// directory
+unique_ptr<BaseStore> NewBaseStore(BaseStoreType type,
+                                   const string &directory);
+
+// An LRU cache of the hot bases in front of a BaseStore, holding at most
+// capacity bytes of values, 0 to fetch every base from the store. The
+// returned values stay valid after they are evicted. Thread safe.
+class BaseCache {
+public:
+  BaseCache(const BaseStore &store, size_t capacity);
+
+  // nullptr if the store can't return key
+  shared_ptr<const string> Get(const string &key);
+
+  size_t Hits() const { return hits_; }
+  size_t Misses() const { return misses_; }
+  size_t Evictions() const { return evictions_; }
+
+private:
+  typedef pair<string, shared_ptr<const string>> Entry;
+
+  const BaseStore &store_;
+  const size_t kCapacity;
+  mutex mutex_;
+  // most recent first
+  list<Entry> entries_;
+  unordered_map<string, list<Entry>::iterator> positions_;
+  size_t bytes_ = 0;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+  size_t evictions_ = 0;
+};
@@ -0,0 +1,307 @@
+#include "delta_compress.h"
+#include "delta_compress_stream.h"
+#include "odess_similarity_detection.h"
+#include "synthetic_data.h"
+#include "util/coding.h"
+#include "util/xxhash.h"
+#include "gdelta_init/gdelta_init.h"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace std;
+
+// Microbenchmarks of the kernels under the end-to-end benchmark of main.cc.
+// Every benchmark reports ns/op, bytes/s and cycles/byte. The cycles are read
+// from the time stamp counter, so they are reference cycles, not core cycles
+// when the frequency scales. Run with --benchmark_filter=<regex> to select.
+
+static uint64_t ReadCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static void SetThroughput(benchmark::State &state, uint64_t cycles,
+                          size_t bytes_per_iteration) {
+  const double bytes = (double)state.iterations() * bytes_per_iteration;
+  state.SetBytesProcessed(bytes);
+  if (cycles && bytes)
+    state.counters["cycles/byte"] = cycles / bytes;
+}
+
+// A base record of size bytes and a record similar to it, with about
+// edit_rate of its bytes edited.
+static void MakeSimilarRecords(size_t size, double edit_rate, string *base,
+                               string *input) {
+  SyntheticDataOptions options;
+  options.record_number = 2;
+  options.size_distribution = kFixedSize;
+  options.min_record_size = options.max_record_size = size;
+  options.cluster_size = 2;
+  options.edit_rate = edit_rate;
+  SyntheticDataGenerator generator(options);
+  string key;
+  generator.Next(&key, base);
+  generator.Next(&key, input);
+}
+
+// Records of size bytes in clusters of 8 similar records
+static void MakeRecords(size_t number, size_t size, vector<string> *keys,
+                        vector<string> *values) {
+  SyntheticDataOptions options;
+  options.record_number = number;
+  options.size_distribution = kFixedSize;
+  options.min_record_size = options.max_record_size = size;
+  SyntheticDataGenerator generator(options);
+  string key, value;
+  while (generator.Next(&key, &value)) {
+    keys->push_back(key);
+    values->push_back(value);
+  }
+}
+
+// Arguments of the codec benchmarks: record size, edit rate in per mille
+static void DeltaArguments(benchmark::internal::Benchmark *b) {
+  for (int size : {1 << 10, 4 << 10, 64 << 10})
+    for (int edit_per_mille : {10, 50})
+      b->Args({size, edit_per_mille});
+  b->ArgNames({"size", "edit_per_mille"});
+}
+
+static void BM_DeltaCompress(benchmark::State &state, DeltaCompressType type) {
+  string base, input, delta;
+  MakeSimilarRecords(state.range(0), state.range(1) / 1000., &base, &input);
+  uint64_t start = ReadCycles();
+  for (auto _ : state) {
+    // DeltaCompress appends to the output
+    delta.clear();
+    if (!DeltaCompress(type, input, base, &delta)) {
+      state.SkipWithError("records are not similar enough to delta compress");
+      break;
+    }
+    benchmark::DoNotOptimize(delta.data());
+  }
+  SetThroughput(state, ReadCycles() - start, input.size());
+  state.counters["ratio"] = (double)input.size() / max<size_t>(delta.size(), 1);
+}
+
+static void BM_DeltaUncompress(benchmark::State &state,
+                               DeltaCompressType type) {
+  string base, input, delta, output;
+  MakeSimilarRecords(state.range(0), state.range(1) / 1000., &base, &input);
+  if (!DeltaCompress(type, input, base, &delta)) {
+    state.SkipWithError("records are not similar enough to delta compress");
+    return;
+  }
+  uint64_t start = ReadCycles();
+  for (auto _ : state) {
+    DeltaUncompress(type, delta, base, &output);
+    benchmark::DoNotOptimize(output.data());
+  }
+  SetThroughput(state, ReadCycles() - start, input.size());
+}
+
+// Delta compress through the stream API in 4KB chunks and decode the result
+// with DeltaUncompress(), then decode the output of DeltaCompress() through
+// the stream API. Fails if either round trip doesn't return the input.
+static void BM_DeltaStreamRoundTrip(benchmark::State &state,
+                                    DeltaCompressType type) {
+  const size_t kChunkSize = 4 << 10;
+  string base, input, delta;
+  MakeSimilarRecords(state.range(0), state.range(1) / 1000., &base, &input);
+  if (!DeltaCompress(type, input, base, &delta)) {
+    state.SkipWithError("records are not similar enough to delta compress");
+    return;
+  }
+  uint64_t start = ReadCycles();
+  for (auto _ : state) {
+    string stream_delta, output, stream_output;
+    DeltaCompressStream compress(type, base, input.size());
+    DeltaUncompressStream uncompress(type, base);
+    if (!RunStream(compress, input, kChunkSize, &stream_delta) ||
+        !DeltaUncompress(type, stream_delta, base, &output) ||
+        output != input ||
+        !RunStream(uncompress, delta, kChunkSize, &stream_output) ||
+        stream_output != input) {
+      state.SkipWithError("stream round trip doesn't return the input");
+      break;
+    }
+    benchmark::DoNotOptimize(stream_output.data());
+  }
+  SetThroughput(state, ReadCycles() - start, input.size());
+}
+
+static void BM_GenerateSuperFeatures(benchmark::State &state) {
+  string base, input;
+  MakeSimilarRecords(state.range(0), 0, &base, &input);
+  FeatureGenerator generator;
+  uint64_t start = ReadCycles();
+  for (auto _ : state) {
+    SuperFeatures super_features = generator.GenerateSuperFeatures(base);
+    benchmark::DoNotOptimize(super_features.data());
+  }
+  SetThroughput(state, ReadCycles() - start, base.size());
+}
+BENCHMARK(BM_GenerateSuperFeatures)->RangeMultiplier(4)->Range(256, 64 << 10);
+
+static void BM_GenerateSuperFeaturesByteByByte(benchmark::State &state) {
+  string base, input;
+  MakeSimilarRecords(state.range(0), 0, &base, &input);
+  FeatureGenerator generator;
+  uint64_t start = ReadCycles();
+  for (auto _ : state) {
+    SuperFeatures super_features =
+        generator.GenerateSuperFeaturesByteByByte(base);
+    benchmark::DoNotOptimize(super_features.data());
+  }
+  SetThroughput(state, ReadCycles() - start, base.size());
+}
+BENCHMARK(BM_GenerateSuperFeaturesByteByByte)
+    ->RangeMultiplier(4)
+    ->Range(256, 64 << 10);
+
+// Huge values scanned at most 16KB, cycles/byte are of the whole value
+static void BM_GenerateSuperFeaturesMaxScan(benchmark::State &state) {
+  string base, input;
+  MakeSimilarRecords(state.range(0), 0, &base, &input);
+  FeatureParameters parameters;
+  parameters.max_scan_bytes = 16 << 10;
+  FeatureGenerator generator(parameters);
+  uint64_t start = ReadCycles();
+  for (auto _ : state) {
+    SuperFeatures super_features = generator.GenerateSuperFeatures(base);
+    benchmark::DoNotOptimize(super_features.data());
+  }
+  SetThroughput(state, ReadCycles() - start, base.size());
+}
+BENCHMARK(BM_GenerateSuperFeaturesMaxScan)
+    ->RangeMultiplier(4)
+    ->Range(64 << 10, 1 << 20);
+
+// Values of every length of a varint, 1 to 5 bytes
+static vector<uint32_t> VarintValues() {
+  vector<uint32_t> values;
+  for (uint32_t i = 0; i < 1024; ++i)
+    values.push_back((i * 2654435761u) >> (i % 5 * 7));
+  return values;
+}
+
+static void BM_PutVarint32(benchmark::State &state) {
+  vector<uint32_t> values = VarintValues();
+  string encoded;
+  uint64_t start = ReadCycles();
+  for (auto _ : state) {
+    encoded.clear();
+    for (uint32_t value : values)
+      PutVarint32(&encoded, value);
+    benchmark::DoNotOptimize(encoded.data());
+  }
+  SetThroughput(state, ReadCycles() - start, encoded.size());
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_PutVarint32);
+
+static void BM_GetVarint32(benchmark::State &state) {
+  string encoded;
+  for (uint32_t value : VarintValues())
+    PutVarint32(&encoded, value);
+  const char *limit = encoded.data() + encoded.size();
+  size_t decoded = 0;
+  uint64_t start = ReadCycles();
+  for (auto _ : state) {
+    uint32_t value = 0;
+    const char *p = encoded.data();
+    while (p && p < limit) {
+      p = GetVarint32Ptr(p, limit, &value);
+      ++decoded;
+    }
+    benchmark::DoNotOptimize(value);
+  }
+  SetThroughput(state, ReadCycles() - start, encoded.size());
+  state.SetItemsProcessed(decoded);
+}
+BENCHMARK(BM_GetVarint32);
+
+static void BM_XXH64(benchmark::State &state) {
+  string input(state.range(0), 'x');
+  for (size_t i = 0; i < input.size(); ++i)
+    input[i] = (char)(i * 131);
+  uint64_t start = ReadCycles();
+  for (auto _ : state)
+    benchmark::DoNotOptimize(XXH64(input.data(), input.size(), 0));
+  SetThroughput(state, ReadCycles() - start, input.size());
+}
+BENCHMARK(BM_XXH64)->RangeMultiplier(8)->Range(8, 64 << 10);
+
+static const size_t kTableRecords = 1024;
+
+static void BM_FeatureIndexTablePut(benchmark::State &state) {
+  vector<string> keys, values;
+  MakeRecords(kTableRecords, state.range(0), &keys, &values);
+  FeatureIndexTable table;
+  size_t i = 0;
+  uint64_t start = ReadCycles();
+  for (auto _ : state) {
+    table.Put(keys[i], values[i]);
+    i = (i + 1) % kTableRecords;
+  }
+  SetThroughput(state, ReadCycles() - start, state.range(0));
+}
+BENCHMARK(BM_FeatureIndexTablePut)->Arg(1 << 10)->Arg(4 << 10);
+
+// GetSimilarRecordsKeys removes the records it finds from the table, so the
+// keys are looked up in order like ScanSimilarRecords does, and the table is
+// filled again when all of them are looked up.
+static void BM_FeatureIndexTableLookup(benchmark::State &state) {
+  vector<string> keys, values;
+  MakeRecords(kTableRecords, state.range(0), &keys, &values);
+  FeatureIndexTable table;
+  size_t i = kTableRecords;
+  uint64_t cycles = 0;
+  for (auto _ : state) {
+    if (i == kTableRecords) {
+      state.PauseTiming();
+      for (size_t j = 0; j < kTableRecords; ++j)
+        table.Put(keys[j], values[j]);
+      i = 0;
+      state.ResumeTiming();
+    }
+    vector<string> similar_keys;
+    uint64_t start = ReadCycles();
+    table.GetSimilarRecordsKeys(keys[i++], similar_keys);
+    cycles += ReadCycles() - start;
+    benchmark::DoNotOptimize(similar_keys.data());
+  }
+  SetThroughput(state, cycles, state.range(0));
+}
+BENCHMARK(BM_FeatureIndexTableLookup)->Arg(1 << 10)->Arg(4 << 10);
+
+int main(int argc, char **argv) {
+  initematrix();
+  for (uint8_t i = kXDelta; i < kNumberOfDeltaCompression; ++i) {
+    DeltaCompressType type = (DeltaCompressType)i;
+    benchmark::RegisterBenchmark(("BM_DeltaCompress/" + ToString(type)).c_str(),
+                                 BM_DeltaCompress, type)
+        ->Apply(DeltaArguments);
+    benchmark::RegisterBenchmark(
+        ("BM_DeltaUncompress/" + ToString(type)).c_str(), BM_DeltaUncompress,
+        type)
+        ->Apply(DeltaArguments);
+    benchmark::RegisterBenchmark(
+        ("BM_DeltaStreamRoundTrip/" + ToString(type)).c_str(),
+        BM_DeltaStreamRoundTrip, type)
+        ->Apply(DeltaArguments);
+  }
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
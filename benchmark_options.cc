@@ -0,0 +1,711 @@
+#include "benchmark_options.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <iostream>
+#include <sstream>
+
+enum OptionId : int {
+  kDataSetOption = 256,
+  kCodecOption,
+  kDetectorOption,
+  kSampleMaskOption,
+  kFeaturesOption,
+  kSuperFeaturesOption,
+  kMaxScanBytesOption,
+  kFeatureSeedOption,
+  kSaveIndexOption,
+  kLoadIndexOption,
+  kSweepOption,
+  kSweepDetectorsOption,
+  kSweepSampleMasksOption,
+  kSweepFeaturesOption,
+  kSweepSuperFeaturesOption,
+  kSweepMaxScanBytesOption,
+  kOracleOption,
+  kOracleSamplesOption,
+  kPartitionsOption,
+  kPartitionDirectoryOption,
+  kBoundedIndexOption,
+  kEvictionOption,
+  kBoundedBudgetsOption,
+  kBudgetUnitOption,
+  kReadReplayOption,
+  kBaseStoreOption,
+  kBaseStoreDirectoryOption,
+  kBaseCacheOption,
+  kReadsOption,
+  kReadDistributionOption,
+  kZipfThetaOption,
+  kReadTraceOption,
+  kOnlineOption,
+  kWritersOption,
+  kReadersOption,
+  kUpdateRatioOption,
+  kNumaOption,
+  kStreamCheckOption,
+  kThreadsOption,
+  kSchedulerOption,
+  kPercentageOption,
+  kNoArenaOption,
+  kSyntheticRecordsOption,
+  kSyntheticSizeOption,
+  kSyntheticDistributionOption,
+  kSyntheticClusterSizeOption,
+  kSyntheticEditRateOption,
+  kSyntheticSeedOption,
+  kNoSelfOption,
+  kNoEntropyOption,
+  kNoDictionaryOption,
+  kMultiBasesOption,
+  kPerfCountersOption,
+  kFormatOption,
+  kOutputOption,
+  kHelpOption,
+};
+
+static const struct option kLongOptions[] = {
+    {"dataset", required_argument, nullptr, kDataSetOption},
+    {"codec", required_argument, nullptr, kCodecOption},
+    {"detector", required_argument, nullptr, kDetectorOption},
+    {"sample-mask", required_argument, nullptr, kSampleMaskOption},
+    {"features", required_argument, nullptr, kFeaturesOption},
+    {"super-features", required_argument, nullptr, kSuperFeaturesOption},
+    {"max-scan-bytes", required_argument, nullptr, kMaxScanBytesOption},
+    {"feature-seed", required_argument, nullptr, kFeatureSeedOption},
+    {"save-index", required_argument, nullptr, kSaveIndexOption},
+    {"load-index", required_argument, nullptr, kLoadIndexOption},
+    {"sweep", no_argument, nullptr, kSweepOption},
+    {"sweep-detectors", required_argument, nullptr, kSweepDetectorsOption},
+    {"sweep-sample-masks", required_argument, nullptr,
+     kSweepSampleMasksOption},
+    {"sweep-features", required_argument, nullptr, kSweepFeaturesOption},
+    {"sweep-super-features", required_argument, nullptr,
+     kSweepSuperFeaturesOption},
+    {"sweep-max-scan-bytes", required_argument, nullptr,
+     kSweepMaxScanBytesOption},
+    {"oracle", no_argument, nullptr, kOracleOption},
+    {"oracle-samples", required_argument, nullptr, kOracleSamplesOption},
+    {"partitions", required_argument, nullptr, kPartitionsOption},
+    {"partition-dir", required_argument, nullptr, kPartitionDirectoryOption},
+    {"bounded-index", no_argument, nullptr, kBoundedIndexOption},
+    {"eviction", required_argument, nullptr, kEvictionOption},
+    {"bounded-budgets", required_argument, nullptr, kBoundedBudgetsOption},
+    {"budget-unit", required_argument, nullptr, kBudgetUnitOption},
+    {"read-replay", no_argument, nullptr, kReadReplayOption},
+    {"base-store", required_argument, nullptr, kBaseStoreOption},
+    {"base-store-dir", required_argument, nullptr, kBaseStoreDirectoryOption},
+    {"base-cache", required_argument, nullptr, kBaseCacheOption},
+    {"reads", required_argument, nullptr, kReadsOption},
+    {"read-distribution", required_argument, nullptr,
+     kReadDistributionOption},
+    {"zipf-theta", required_argument, nullptr, kZipfThetaOption},
+    {"read-trace", required_argument, nullptr, kReadTraceOption},
+    {"online", no_argument, nullptr, kOnlineOption},
+    {"writers", required_argument, nullptr, kWritersOption},
+    {"readers", required_argument, nullptr, kReadersOption},
+    {"update-ratio", required_argument, nullptr, kUpdateRatioOption},
+    {"numa", optional_argument, nullptr, kNumaOption},
+    {"stream-check", no_argument, nullptr, kStreamCheckOption},
+    {"threads", required_argument, nullptr, kThreadsOption},
+    {"scheduler", required_argument, nullptr, kSchedulerOption},
+    {"percentage", required_argument, nullptr, kPercentageOption},
+    {"no-arena", no_argument, nullptr, kNoArenaOption},
+    {"synthetic-records", required_argument, nullptr,
+     kSyntheticRecordsOption},
+    {"synthetic-size", required_argument, nullptr, kSyntheticSizeOption},
+    {"synthetic-distribution", required_argument, nullptr,
+     kSyntheticDistributionOption},
+    {"synthetic-cluster-size", required_argument, nullptr,
+     kSyntheticClusterSizeOption},
+    {"synthetic-edit-rate", required_argument, nullptr,
+     kSyntheticEditRateOption},
+    {"synthetic-seed", required_argument, nullptr, kSyntheticSeedOption},
+    {"no-self", no_argument, nullptr, kNoSelfOption},
+    {"no-entropy", no_argument, nullptr, kNoEntropyOption},
+    {"no-dictionary", no_argument, nullptr, kNoDictionaryOption},
+    {"multi-bases", required_argument, nullptr, kMultiBasesOption},
+    {"perf-counters", no_argument, nullptr, kPerfCountersOption},
+    {"format", required_argument, nullptr, kFormatOption},
+    {"output", required_argument, nullptr, kOutputOption},
+    {"help", no_argument, nullptr, kHelpOption},
+    {nullptr, 0, nullptr, 0},
+};
+
+void PrintUsage(const char *program) {
+  printf(
+      "Usage: %s [options] [data set spec...]\n"
+      "\n"
+      "Data sets and methods:\n"
+      "  --dataset=NAME[,NAME]     wikipedia, enron_mail, stack_overflow,\n"
+      "                            stack_overflow_comment, synthetic, all,\n"
+      "                            or an adapter spec: dir:<directory>,\n"
+      "                            lines:<file>[:<delimiter>:<key field>],\n"
+      "                            records:<file>. Can be repeated.\n"
+      "  --codec=NAME[,NAME]       xdelta, edelta, gdelta, gdelta_original,\n"
+      "                            gdelta_init or all (default all)\n"
+      "  --no-self                 skip the lz self compression fallback\n"
+      "  --no-entropy              skip the +whole-delta-huffman second stage\n"
+      "                            rows, order-0 Huffman over each delta\n"
+      "  --no-dictionary           skip the +dict cluster dictionary rows\n"
+      "  --multi-bases=K           bases of the +multi rows, 0 to skip "
+      "(default 3)\n"
+      "\n"
+      "Similarity detection:\n"
+      "  --detector=NAME           odess, n-transform, finesse or minhash\n"
+      "                            (default odess)\n"
+      "  --sample-mask=MASK        1/512, 1/256, 1/128, 1/4 or a hex mask,\n"
+      "                            only used by odess\n"
+      "  --features=N              features per record (default %zu)\n"
+      "  --super-features=N        super features per record (default %zu)\n"
+      "  --max-scan-bytes=N        odess scans at most N bytes of a value in\n"
+      "                            %zu regions, 0 scans it all (default 0)\n"
+      "  --feature-seed=N          seed of the transforms (default 0x%llx)\n"
+      "  --save-index=FILE         write the feature index of the data set\n"
+      "  --load-index=FILE         load the feature index and its parameters\n"
+      "                            instead of generating the features\n"
+      "  --sweep                   evaluate every combination of the sweep\n"
+      "                            parameters and print the Pareto frontier\n"
+      "                            of delta ratio, feature throughput and\n"
+      "                            index memory, using the first --codec\n"
+      "  --sweep-detectors=LIST    default odess\n"
+      "  --sweep-sample-masks=LIST default 1/512,1/256,1/128,1/4\n"
+      "  --sweep-features=LIST     default 6,12,24\n"
+      "  --sweep-super-features=LIST default 2,3,4,6\n"
+      "  --sweep-max-scan-bytes=LIST default 0\n"
+      "  --oracle                  delta compress sampled records against\n"
+      "                            every record to measure the precision and\n"
+      "                            recall of the detection, using the first\n"
+      "                            --codec\n"
+      "  --oracle-samples=N        sampled records (default 100)\n"
+      "  --partitions=LIST         build the feature index with each number\n"
+      "                            of processes, e.g. 1,2,4,8, exchanging\n"
+      "                            the postings through files\n"
+      "  --partition-dir=DIR       where the files are written (default "
+      "/tmp)\n"
+      "  --bounded-index           stream the records through an index of\n"
+      "                            bounded size, evicting bases, and compare\n"
+      "                            the hit rate and delta ratio with the\n"
+      "                            unbounded index, using the first --codec\n"
+      "  --eviction=LIST           lru, clock or lfu (default all)\n"
+      "  --bounded-budgets=LIST    percents of the unbounded index (default\n"
+      "                            10,25,50)\n"
+      "  --budget-unit=UNIT        records or bytes (default records)\n"
+      "  --read-replay             decode point reads of the delta\n"
+      "                            compressed records, fetching the bases\n"
+      "                            through an LRU cache of each size, with\n"
+      "                            every --codec\n"
+      "  --base-store=NAME         memory or file (default memory)\n"
+      "  --base-store-dir=DIR      where the file store is written (default\n"
+      "                            /tmp)\n"
+      "  --base-cache=LIST         cache sizes in percent of the bytes of all\n"
+      "                            bases (default 0,10,50)\n"
+      "  --reads=N                 reads of every distribution (default\n"
+      "                            100000), on --threads threads\n"
+      "  --read-distribution=LIST  uniform, zipfian or latest (default all)\n"
+      "  --zipf-theta=THETA        skew of zipfian and latest, in (0, 1)\n"
+      "                            (default 0.99)\n"
+      "  --read-trace=FILE         replay the keys of FILE, one per line,\n"
+      "                            instead\n"
+      "  --online                  put the records into a store that delta\n"
+      "                            compresses every put against a similar\n"
+      "                            record, while reading them, with every\n"
+      "                            --codec\n"
+      "  --writers=N               writer threads (default 1)\n"
+      "  --readers=N               reader threads, 0 for none (default 1)\n"
+      "  --update-ratio=R          updates of a written record per insert\n"
+      "                            (default 0.2)\n"
+      "  --numa[=LIST]             delta compress with the base groups and\n"
+      "                            threads placed on the NUMA nodes: local\n"
+      "                            pins the threads of a node to it and\n"
+      "                            allocates there, interleaved spreads the\n"
+      "                            memory over all nodes (default both)\n"
+      "  --stream-check            round trip records around one and over\n"
+      "                            three stream windows through the stream\n"
+      "                            API of every --codec instead of running\n"
+      "                            the data sets\n"
+      "\n"
+      "Run:\n"
+      "  --threads=N               compress/uncompress threads (default 1)\n"
+      "  --scheduler=NAME          static deals the base groups out to the\n"
+      "                            threads, stealing runs every pair as a\n"
+      "                            task, stolen by idle threads (default\n"
+      "                            stealing)\n"
+      "  --percentage=N            stop loading a data set at N%% (default "
+      "100)\n"
+      "  --no-arena                allocate the containers of a data set\n"
+      "                            with new instead of from an arena, the\n"
+      "                            strings in them always use new\n"
+      "  --perf-counters           report cycles, instructions, cache, branch\n"
+      "                            and TLB misses of every phase\n"
+      "\n"
+      "Synthetic data set:\n"
+      "  --synthetic-records=N\n"
+      "  --synthetic-size=MIN[:MAX]        record size in bytes\n"
+      "  --synthetic-distribution=NAME     fixed, uniform or log-uniform\n"
+      "  --synthetic-cluster-size=N\n"
+      "  --synthetic-edit-rate=RATE\n"
+      "  --synthetic-seed=N\n"
+      "\n"
+      "Output:\n"
+      "  --format=FORMAT           table, json or csv (default table)\n"
+      "  --output=FILE             where json/csv results are written\n",
+      program, FeatureParameters().feature_number,
+      FeatureParameters().super_feature_number, FeatureGenerator::kScanRegions,
+      (unsigned long long)FeatureParameters::kDefaultSeed);
+}
+
+static bool ParseSize(const char *arg, size_t *value) {
+  char *end;
+  errno = 0;
+  unsigned long long v = strtoull(arg, &end, 0);
+  if (errno || end == arg || *end != '\0' || arg[0] == '-')
+    return false;
+  *value = v;
+  return true;
+}
+
+static bool ParseDouble(const char *arg, double *value) {
+  char *end;
+  errno = 0;
+  *value = strtod(arg, &end);
+  return !errno && end != arg && *end == '\0';
+}
+
+static vector<string> Split(const string &s, char delimiter) {
+  vector<string> parts;
+  stringstream ss(s);
+  string part;
+  while (getline(ss, part, delimiter))
+    parts.push_back(part);
+  return parts;
+}
+
+static bool ParseDataSets(const string &arg, BenchmarkOptions *options) {
+  if (arg.find(':') != string::npos) {
+    options->adapter_specs.push_back(arg);
+    return true;
+  }
+  for (const string &name : Split(arg, ',')) {
+    bool found = false;
+    for (uint8_t i = kWikipedia; i < kNumberOfDataSet; ++i) {
+      if (name == "all" || name == ToString((DataSetType)i)) {
+        options->datasets.push_back((DataSetType)i);
+        found = true;
+      }
+    }
+    if (!found) {
+      cerr << "unknown data set: " << name << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool ParseCodecs(const string &arg, BenchmarkOptions *options) {
+  for (const string &name : Split(arg, ',')) {
+    bool found = false;
+    for (uint8_t i = kXDelta; i < kNumberOfDeltaCompression; ++i) {
+      if (name == "all" || name == ToString((DeltaCompressType)i)) {
+        options->codecs.push_back((DeltaCompressType)i);
+        found = true;
+      }
+    }
+    if (!found) {
+      cerr << "unknown delta compression method: " << name << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool ParseDetector(const string &arg, SimilarityDetectorType *type) {
+  for (uint8_t i = 0; i < kNumberOfSimilarityDetector; ++i) {
+    if (arg == ToString((SimilarityDetectorType)i)) {
+      *type = (SimilarityDetectorType)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool ParseSampleMask(const string &arg, feature_t *mask) {
+  if (arg == "1/512")
+    *mask = k1_512RatioMask;
+  else if (arg == "1/256")
+    *mask = k1_256RatioMask;
+  else if (arg == "1/128")
+    *mask = k1_128RatioMask;
+  else if (arg == "1/4")
+    *mask = k1_4RatioMask;
+  else {
+    size_t value;
+    if (!ParseSize(arg.c_str(), &value))
+      return false;
+    *mask = value;
+  }
+  return true;
+}
+
+string SampleMaskName(feature_t mask) {
+  switch (mask) {
+  case k1_512RatioMask:
+    return "1/512";
+  case k1_256RatioMask:
+    return "1/256";
+  case k1_128RatioMask:
+    return "1/128";
+  case k1_4RatioMask:
+    return "1/4";
+  default: {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "0x%016llx", (unsigned long long)mask);
+    return buffer;
+  }
+  }
+}
+
+template <typename T>
+static bool ParseList(const string &arg, bool (*parse)(const string &, T *),
+                      vector<T> *values) {
+  values->clear();
+  for (const string &item : Split(arg, ',')) {
+    T value;
+    if (!parse(item, &value))
+      return false;
+    values->push_back(value);
+  }
+  return !values->empty();
+}
+
+static bool ParseSizeItem(const string &arg, size_t *value) {
+  return ParseSize(arg.c_str(), value) && *value > 0;
+}
+
+static bool ParseSizeOrZeroItem(const string &arg, size_t *value) {
+  return ParseSize(arg.c_str(), value);
+}
+
+static bool ParseSizeDistribution(const string &arg,
+                                  RecordSizeDistribution *distribution) {
+  for (uint8_t i = 0; i < kNumberOfRecordSizeDistribution; ++i) {
+    if (arg == ToString((RecordSizeDistribution)i)) {
+      *distribution = (RecordSizeDistribution)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool ParseEvictionPolicy(const string &arg, EvictionPolicyType *type) {
+  for (uint8_t i = 0; i < kNumberOfEvictionPolicy; ++i) {
+    if (arg == ToString((EvictionPolicyType)i)) {
+      *type = (EvictionPolicyType)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool ParsePercentItem(const string &arg, size_t *value) {
+  return ParseSizeItem(arg, value) && *value <= 100;
+}
+
+static bool ParsePercentOrZeroItem(const string &arg, size_t *value) {
+  return ParseSizeOrZeroItem(arg, value) && *value <= 100;
+}
+
+static bool ParseReadDistribution(const string &arg,
+                                  ReadDistribution *distribution) {
+  for (uint8_t i = 0; i < kNumberOfReadDistribution; ++i) {
+    if (arg == ToString((ReadDistribution)i)) {
+      *distribution = (ReadDistribution)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool ParseBaseStore(const string &arg, BaseStoreType *type) {
+  for (uint8_t i = 0; i < kNumberOfBaseStore; ++i) {
+    if (arg == ToString((BaseStoreType)i)) {
+      *type = (BaseStoreType)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool ParseScheduler(const string &arg, SchedulerType *type) {
+  for (uint8_t i = 0; i < kNumberOfScheduler; ++i) {
+    if (arg == ToString((SchedulerType)i)) {
+      *type = (SchedulerType)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool ParseNumaPlacement(const string &arg, NumaPlacement *placement) {
+  for (uint8_t i = 0; i < kNumberOfNumaPlacement; ++i) {
+    if (arg == ToString((NumaPlacement)i)) {
+      *placement = (NumaPlacement)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool ParseOutputFormat(const string &arg, OutputFormat *format) {
+  for (uint8_t i = 0; i < kNumberOfOutputFormat; ++i) {
+    if (arg == ToString((OutputFormat)i)) {
+      *format = (OutputFormat)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool ParseOption(int id, const char *arg, BenchmarkOptions *options) {
+  SyntheticDataOptions &synthetic = options->synthetic;
+  FeatureParameters &features = options->feature_parameters;
+  switch (id) {
+  case kDataSetOption:
+    return ParseDataSets(arg, options);
+  case kCodecOption:
+    return ParseCodecs(arg, options);
+  case kDetectorOption:
+    return ParseDetector(arg, &features.detector);
+  case kSampleMaskOption:
+    return ParseSampleMask(arg, &features.sample_mask);
+  case kFeaturesOption:
+    return ParseSize(arg, &features.feature_number);
+  case kSuperFeaturesOption:
+    return ParseSize(arg, &features.super_feature_number);
+  case kMaxScanBytesOption:
+    return ParseSize(arg, &features.max_scan_bytes);
+  case kFeatureSeedOption: {
+    size_t seed;
+    if (!ParseSize(arg, &seed))
+      return false;
+    features.seed = seed;
+    return true;
+  }
+  case kSaveIndexOption:
+    options->save_index_path = arg;
+    return true;
+  case kLoadIndexOption:
+    options->load_index_path = arg;
+    return true;
+  case kSweepOption:
+    options->sweep = true;
+    return true;
+  case kSweepDetectorsOption:
+    return ParseList(arg, ParseDetector, &options->sweep_detectors);
+  case kSweepSampleMasksOption:
+    return ParseList(arg, ParseSampleMask, &options->sweep_sample_masks);
+  case kSweepFeaturesOption:
+    return ParseList(arg, ParseSizeItem, &options->sweep_feature_numbers);
+  case kSweepSuperFeaturesOption:
+    return ParseList(arg, ParseSizeItem,
+                     &options->sweep_super_feature_numbers);
+  case kSweepMaxScanBytesOption:
+    return ParseList(arg, ParseSizeOrZeroItem, &options->sweep_max_scan_bytes);
+  case kOracleOption:
+    options->oracle = true;
+    return true;
+  case kOracleSamplesOption:
+    return ParseSizeItem(arg, &options->oracle_samples);
+  case kPartitionsOption:
+    return ParseList(arg, ParseSizeItem, &options->partitions);
+  case kPartitionDirectoryOption:
+    options->partition_directory = arg;
+    return true;
+  case kBoundedIndexOption:
+    options->bounded_index = true;
+    return true;
+  case kEvictionOption:
+    return ParseList(arg, ParseEvictionPolicy, &options->eviction_policies);
+  case kBoundedBudgetsOption:
+    return ParseList(arg, ParsePercentItem, &options->bounded_budgets);
+  case kBudgetUnitOption:
+    if (strcmp(arg, "records") != 0 && strcmp(arg, "bytes") != 0)
+      return false;
+    options->budget_in_bytes = strcmp(arg, "bytes") == 0;
+    return true;
+  case kReadReplayOption:
+    options->read_replay = true;
+    return true;
+  case kBaseStoreOption:
+    return ParseBaseStore(arg, &options->base_store);
+  case kBaseStoreDirectoryOption:
+    options->base_store_directory = arg;
+    return true;
+  case kBaseCacheOption:
+    return ParseList(arg, ParsePercentOrZeroItem,
+                     &options->base_cache_percents);
+  case kReadsOption:
+    return ParseSizeItem(arg, &options->reads);
+  case kReadDistributionOption:
+    return ParseList(arg, ParseReadDistribution,
+                     &options->read_distributions);
+  case kZipfThetaOption:
+    return ParseDouble(arg, &options->zipf_theta) &&
+           options->zipf_theta > 0 && options->zipf_theta < 1;
+  case kReadTraceOption:
+    options->read_trace_path = arg;
+    return true;
+  case kNumaOption:
+    if (arg == nullptr) {
+      options->numa_placements = {kLocalPlacement, kInterleavedPlacement};
+      return true;
+    }
+    return ParseList(arg, ParseNumaPlacement, &options->numa_placements);
+  case kOnlineOption:
+    options->online = true;
+    return true;
+  case kWritersOption:
+    return ParseSizeItem(arg, &options->writers);
+  case kReadersOption:
+    return ParseSize(arg, &options->readers);
+  case kUpdateRatioOption:
+    return ParseDouble(arg, &options->update_ratio) &&
+           options->update_ratio >= 0 && options->update_ratio <= 1;
+  case kStreamCheckOption:
+    options->stream_check = true;
+    return true;
+  case kThreadsOption:
+    return ParseSize(arg, &options->threads);
+  case kSchedulerOption:
+    return ParseScheduler(arg, &options->scheduler);
+  case kPercentageOption:
+    return ParseSize(arg, &options->percentage);
+  case kNoArenaOption:
+    options->arena = false;
+    return true;
+  case kSyntheticRecordsOption:
+    return ParseSize(arg, &synthetic.record_number);
+  case kSyntheticSizeOption: {
+    vector<string> sizes = Split(arg, ':');
+    if (sizes.empty() || sizes.size() > 2 ||
+        !ParseSize(sizes[0].c_str(), &synthetic.min_record_size))
+      return false;
+    synthetic.max_record_size = synthetic.min_record_size;
+    return sizes.size() == 1 ||
+           ParseSize(sizes[1].c_str(), &synthetic.max_record_size);
+  }
+  case kSyntheticDistributionOption:
+    return ParseSizeDistribution(arg, &synthetic.size_distribution);
+  case kSyntheticClusterSizeOption:
+    return ParseSize(arg, &synthetic.cluster_size);
+  case kSyntheticEditRateOption:
+    return ParseDouble(arg, &synthetic.edit_rate);
+  case kSyntheticSeedOption: {
+    size_t seed;
+    if (!ParseSize(arg, &seed))
+      return false;
+    synthetic.seed = seed;
+    return true;
+  }
+  case kNoSelfOption:
+    options->self_compression = false;
+    return true;
+  case kNoEntropyOption:
+    options->entropy_coding = false;
+    return true;
+  case kNoDictionaryOption:
+    options->cluster_dictionary = false;
+    return true;
+  case kMultiBasesOption:
+    return ParseSize(arg, &options->multi_bases);
+  case kPerfCountersOption:
+    options->perf_counters = true;
+    return true;
+  case kFormatOption:
+    return ParseOutputFormat(arg, &options->format);
+  case kOutputOption:
+    options->output_path = arg;
+    return true;
+  default:
+    return false;
+  }
+}
+
+static bool CheckOptions(BenchmarkOptions *options) {
+  if (options->datasets.empty() && options->adapter_specs.empty()) {
+    for (uint8_t i = kWikipedia; i < kNumberOfDataSet; ++i)
+      options->datasets.push_back((DataSetType)i);
+  }
+  if (options->codecs.empty()) {
+    for (uint8_t i = kXDelta; i < kNumberOfDeltaCompression; ++i)
+      options->codecs.push_back((DeltaCompressType)i);
+  }
+  const FeatureParameters &features = options->feature_parameters;
+  if (features.feature_number == 0 || features.super_feature_number == 0 ||
+      features.feature_number % features.super_feature_number != 0) {
+    cerr << "--features must be a multiple of --super-features" << endl;
+    return false;
+  }
+  if (options->sweep + options->oracle + !options->partitions.empty() +
+          options->bounded_index + options->read_replay + options->online +
+          !options->numa_placements.empty() + options->stream_check >
+      1) {
+    cerr << "--sweep, --oracle, --partitions, --bounded-index, "
+            "--read-replay, --online, --numa and --stream-check can't run "
+            "together"
+         << endl;
+    return false;
+  }
+  if ((!options->save_index_path.empty() ||
+       !options->load_index_path.empty()) &&
+      options->datasets.size() + options->adapter_specs.size() != 1) {
+    cerr << "--save-index and --load-index need exactly one data set" << endl;
+    return false;
+  }
+  if (options->sweep && !options->load_index_path.empty()) {
+    cerr << "--sweep generates its own feature indexes, it can't "
+            "--load-index"
+         << endl;
+    return false;
+  }
+  if (options->threads == 0) {
+    cerr << "--threads must be at least 1" << endl;
+    return false;
+  }
+  if (options->percentage == 0 || options->percentage > 100) {
+    cerr << "--percentage must be in [1, 100]" << endl;
+    return false;
+  }
+  if (options->format != kTableOutput && options->output_path.empty()) {
+    cerr << "--format=" << ToString(options->format) << " needs --output"
+         << endl;
+    return false;
+  }
+  return true;
+}
+
+bool ParseBenchmarkOptions(int argc, char *argv[], BenchmarkOptions *options,
+                           bool *exit) {
+  *exit = false;
+  int id;
+  while ((id = getopt_long(argc, argv, "", kLongOptions, nullptr)) != -1) {
+    if (id == kHelpOption) {
+      PrintUsage(argv[0]);
+      *exit = true;
+      return true;
+    }
+    if (id == '?')
+      return false;
+    if (!ParseOption(id, optarg, options)) {
+      cerr << "bad argument: --" << kLongOptions[id - kDataSetOption].name
+           << "=" << (optarg ? optarg : "") << endl;
+      return false;
+    }
+  }
+  // the remaining arguments are data set adapter specs
+  for (int i = optind; i < argc; ++i)
+    options->adapter_specs.push_back(argv[i]);
+  return CheckOptions(options);
+}
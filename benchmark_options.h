@@ -0,0 +1,128 @@
+#pragma once
+#include "base_store.h"
+#include "bounded_feature_index.h"
+#include "data_reader.h"
+#include "delta_compress.h"
+#include "numa.h"
+#include "odess_similarity_detection.h"
+#include "read_replay.h"
+#include "statistics.h"
+#include "synthetic_data.h"
+#include "task_scheduler.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Everything that can be selected on the command line. The defaults run all
+// built-in data sets with all delta compression methods, single threaded.
+struct BenchmarkOptions {
+  vector<DataSetType> datasets;
+  // data sets read through NewDatasetAdapter()
+  vector<string> adapter_specs;
+  vector<DeltaCompressType> codecs;
+
+  FeatureParameters feature_parameters;
+  // Feature index snapshots, see FeatureIndexTable::Save(). A loaded snapshot
+  // replaces feature_parameters, the records it misses are indexed after it.
+  string save_index_path;
+  string load_index_path;
+
+  // Sweep mode: instead of the normal run, evaluate every combination of the
+  // sweep parameters below, skipping feature numbers that are not a multiple
+  // of the super feature number. The sample masks and the scan caps are only
+  // swept for Odess.
+  // See SweepDataSet() in main.cc.
+  bool sweep = false;
+  vector<SimilarityDetectorType> sweep_detectors{kOdess};
+  vector<feature_t> sweep_sample_masks{k1_512RatioMask, k1_256RatioMask,
+                                       k1_128RatioMask, k1_4RatioMask};
+  vector<size_t> sweep_feature_numbers{6, 12, 24};
+  vector<size_t> sweep_super_feature_numbers{2, 3, 4, 6};
+  vector<size_t> sweep_max_scan_bytes{0};
+
+  // Oracle mode: delta compress oracle_samples sampled records against every
+  // record to measure the precision and recall of the similarity detection.
+  // See OracleDataSet() in main.cc.
+  bool oracle = false;
+  size_t oracle_samples = 100;
+
+  // Partitioned mode: run the similarity detection with the feature index
+  // split over each number of processes, see RunPartitionedIndex().
+  vector<size_t> partitions;
+  // where the processes exchange their postings
+  string partition_directory = "/tmp";
+
+  // Bounded index mode: stream the records through a BoundedFeatureIndex
+  // holding each percent of the records, or of the bytes, of the unbounded
+  // index, with each eviction policy. See BoundedDataSet() in main.cc.
+  bool bounded_index = false;
+  vector<EvictionPolicyType> eviction_policies{kLruEviction, kClockEviction,
+                                               kLfuEviction};
+  vector<size_t> bounded_budgets{10, 25, 50};
+  bool budget_in_bytes = false;
+
+  // Read replay mode: decode point reads of the delta compressed records,
+  // fetching their bases through a BaseCache of each size from the base
+  // store. See ReadReplayDataSet() in main.cc.
+  bool read_replay = false;
+  BaseStoreType base_store = kMemoryBaseStore;
+  string base_store_directory = "/tmp";
+  // percents of the bytes of all bases, 0 fetches every base from the store
+  vector<size_t> base_cache_percents{0, 10, 50};
+  // reads of every distribution, unless read_trace_path gives the keys
+  size_t reads = 100000;
+  vector<ReadDistribution> read_distributions{kUniformReads, kZipfianReads,
+                                              kLatestReads};
+  double zipf_theta = 0.99;
+  string read_trace_path;
+
+  // Online mode: writers put the records into an OnlineStore while readers
+  // read them, see OnlineDataSet() in main.cc.
+  bool online = false;
+  size_t writers = 1;
+  size_t readers = 1;
+  // updates of a written record per insert
+  double update_ratio = 0.2;
+
+  // NUMA mode: delta compress the base groups with each placement over the
+  // NUMA nodes, see NumaDataSet() in main.cc.
+  vector<NumaPlacement> numa_placements;
+
+  // Stream check: instead of the data sets, round trip generated records of
+  // up to a few stream windows through the stream API of every codec. See
+  // CheckDeltaStreams() in main.cc.
+  bool stream_check = false;
+
+  size_t threads = 1;
+  // how the delta compress and uncompress stages spread the pairs over the
+  // threads
+  SchedulerType scheduler = kStealingScheduler;
+  // see DataReader::expected_percentage_
+  size_t percentage = 100;
+  // allocate the containers of every data set from an Arena, see AllData
+  bool arena = true;
+  SyntheticDataOptions synthetic;
+
+  bool self_compression = true;
+  bool entropy_coding = true;
+  bool cluster_dictionary = true;
+  // number of bases of the multi-base delta, 0 to skip it
+  size_t multi_bases = 3;
+
+  // report hardware counters of every phase, see PerfCounters
+  bool perf_counters = false;
+
+  OutputFormat format = kTableOutput;
+  string output_path;
+};
+
+// Returns false and prints the reason on bad arguments.
+// *exit is set if the program should exit without running, e.g. --help.
+bool ParseBenchmarkOptions(int argc, char *argv[], BenchmarkOptions *options,
+                           bool *exit);
+
+void PrintUsage(const char *program);
+
+// "1/128" for the masks of odess_similarity_detection.h, hex otherwise
+string SampleMaskName(feature_t mask);
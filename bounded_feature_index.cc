@@ -0,0 +1,190 @@
+#include "bounded_feature_index.h"
+#include "memory_usage.h"
+
+#include <cassert>
+
+unique_ptr<EvictionPolicy> NewEvictionPolicy(EvictionPolicyType type) {
+  switch (type) {
+  case kClockEviction:
+    return unique_ptr<EvictionPolicy>(new ClockPolicy());
+  case kLfuEviction:
+    return unique_ptr<EvictionPolicy>(new LfuPolicy());
+  default:
+    return unique_ptr<EvictionPolicy>(new LruPolicy());
+  }
+}
+
+void LruPolicy::Insert(const string *key) {
+  order_.push_front(key);
+  positions_[key] = order_.begin();
+}
+
+void LruPolicy::Touch(const string *key) {
+  order_.splice(order_.begin(), order_, positions_.at(key));
+}
+
+const string *LruPolicy::Evict() {
+  assert(!order_.empty());
+  const string *key = order_.back();
+  order_.pop_back();
+  positions_.erase(key);
+  return key;
+}
+
+void ClockPolicy::Insert(const string *key) {
+  size_t slot;
+  if (free_slots_.empty()) {
+    slot = slots_.size();
+    slots_.push_back(Slot{key, false});
+  } else {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+    slots_[slot] = Slot{key, false};
+  }
+  slot_of_[key] = slot;
+}
+
+void ClockPolicy::Touch(const string *key) {
+  slots_[slot_of_.at(key)].referenced = true;
+}
+
+// Clear the reference bits under the hand until a base without one
+const string *ClockPolicy::Evict() {
+  assert(!slot_of_.empty());
+  for (;; hand_ = (hand_ + 1) % slots_.size()) {
+    Slot &slot = slots_[hand_];
+    if (slot.key == nullptr)
+      continue;
+    if (slot.referenced) {
+      slot.referenced = false;
+      continue;
+    }
+    const string *key = slot.key;
+    slot.key = nullptr;
+    free_slots_.push_back(hand_);
+    slot_of_.erase(key);
+    hand_ = (hand_ + 1) % slots_.size();
+    return key;
+  }
+}
+
+// A new key starts at the fewest matches of the resident keys. Starting at 0
+// it would be evicted first once every old key has been matched, and the old
+// clusters would pin the index.
+void LfuPolicy::Insert(const string *key) {
+  Rank rank(ranks_.empty() ? 0 : ranks_.begin()->first.first, clock_++);
+  ranks_[rank] = key;
+  rank_of_[key] = rank;
+}
+
+void LfuPolicy::Touch(const string *key) {
+  Rank &rank = rank_of_.at(key);
+  ranks_.erase(rank);
+  rank = Rank(rank.first + 1, clock_++);
+  ranks_[rank] = key;
+}
+
+const string *LfuPolicy::Evict() {
+  assert(!ranks_.empty());
+  const string *key = ranks_.begin()->second;
+  ranks_.erase(ranks_.begin());
+  rank_of_.erase(key);
+  return key;
+}
+
+BoundedFeatureIndex::BoundedFeatureIndex(EvictionPolicyType policy,
+                                         size_t max_records, size_t max_bytes)
+    : policy_(NewEvictionPolicy(policy)), kMaxRecords(max_records),
+      kMaxBytes(max_bytes) {}
+
+size_t BoundedFeatureIndex::EntryBytes(const string &key,
+                                       const SuperFeatures &super_features) {
+  const size_t entry_node = sizeof(void *) +
+                            sizeof(pair<const string, Entry>) + sizeof(size_t);
+  const size_t posting_node = sizeof(void *) + sizeof(const string *);
+  return AllocationBytes(entry_node) + HeapBytes(key) +
+         AllocationBytes(super_features.size() * sizeof(super_feature_t)) +
+         super_features.size() * AllocationBytes(posting_node);
+}
+
+bool BoundedFeatureIndex::FindBase(const SuperFeatures &super_features,
+                                   string *base_key) {
+  unordered_map<const string *, size_t> shared;
+  const string *best = nullptr;
+  for (super_feature_t sf : super_features) {
+    auto it = postings_.find(sf);
+    if (it == postings_.end())
+      continue;
+    for (const string *key : it->second) {
+      size_t count = ++shared[key];
+      if (best == nullptr || count > shared[best])
+        best = key;
+    }
+  }
+  if (best == nullptr)
+    return false;
+  policy_->Touch(best);
+  *base_key = *best;
+  return true;
+}
+
+void BoundedFeatureIndex::Erase(const string *key) {
+  auto it = entries_.find(*key);
+  for (super_feature_t sf : it->second.super_features) {
+    auto posting = postings_.find(sf);
+    posting->second.erase(key);
+    if (posting->second.empty())
+      postings_.erase(posting);
+  }
+  bytes_ -= it->second.bytes;
+  entries_.erase(it);
+}
+
+void BoundedFeatureIndex::Insert(const string &key,
+                                 const SuperFeatures &super_features) {
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    // drop the old super features, keep the place in the policy
+    const string *resident = &it->first;
+    for (super_feature_t sf : it->second.super_features) {
+      auto posting = postings_.find(sf);
+      posting->second.erase(resident);
+      if (posting->second.empty())
+        postings_.erase(posting);
+    }
+    bytes_ -= it->second.bytes;
+  } else {
+    it = entries_.emplace(key, Entry()).first;
+    policy_->Insert(&it->first);
+  }
+  it->second.super_features = super_features;
+  it->second.bytes = EntryBytes(key, super_features);
+  bytes_ += it->second.bytes;
+  for (super_feature_t sf : super_features)
+    postings_[sf].insert(&it->first);
+
+  while ((kMaxRecords && entries_.size() > kMaxRecords) ||
+         (kMaxBytes && bytes_ > kMaxBytes && entries_.size() > 1)) {
+    Erase(policy_->Evict());
+    ++evictions_;
+  }
+}
+
+ResultRow BoundedIndexResult::ToRow() const {
+  double ratio = stored_size ? (double)original_size / stored_size : 0;
+  ResultRow row("bounded index");
+  row.AddText("policy", policy);
+  row.AddText("budget",
+              budget_percent ? to_string(budget_percent) + "%" : "unbounded");
+  row.AddCount("max records", max_records);
+  row.AddSize("max bytes", max_bytes);
+  row.AddSize("peak bytes", peak_bytes);
+  row.AddCount("lookups", lookups);
+  row.AddCount("hits", hits);
+  row.AddNumber("hit rate", lookups ? (double)hits / lookups : 0, 3);
+  row.AddCount("evictions", evictions);
+  row.AddNumber("delta ratio", ratio, 3);
+  row.AddNumber("ratio lost %",
+                unbounded_ratio ? 100 * (1 - ratio / unbounded_ratio) : 0);
+  return row;
+}
@@ -0,0 +1,153 @@
+#pragma once
+#include "odess_similarity_detection.h"
+#include "statistics.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+enum EvictionPolicyType : uint8_t {
+  kLruEviction,   // least recently inserted or matched base
+  kClockEviction, // second chance, one reference bit per base
+  kLfuEviction,   // least often matched base, the least recent of equals
+  kNumberOfEvictionPolicy
+};
+
+const static string eviction_policy_name[kNumberOfEvictionPolicy]{
+    "lru", "clock", "lfu"};
+
+inline string ToString(EvictionPolicyType type) {
+  return eviction_policy_name[type];
+}
+
+// Chooses the base to evict. The keys are identified by the address of the
+// key stored in the index, which stays the same while it is resident.
+class EvictionPolicy {
+public:
+  virtual ~EvictionPolicy() {}
+
+  virtual void Insert(const string *key) = 0;
+  // key is matched as the base of a new record
+  virtual void Touch(const string *key) = 0;
+  // Choose a resident key to evict and forget it
+  virtual const string *Evict() = 0;
+};
+
+unique_ptr<EvictionPolicy> NewEvictionPolicy(EvictionPolicyType type);
+
+class LruPolicy : public EvictionPolicy {
+public:
+  void Insert(const string *key) override;
+  void Touch(const string *key) override;
+  const string *Evict() override;
+
+private:
+  // most recent first
+  list<const string *> order_;
+  unordered_map<const string *, list<const string *>::iterator> positions_;
+};
+
+class ClockPolicy : public EvictionPolicy {
+public:
+  void Insert(const string *key) override;
+  void Touch(const string *key) override;
+  const string *Evict() override;
+
+private:
+  struct Slot {
+    const string *key;
+    bool referenced;
+  };
+  // evicted slots are reused by the next insert
+  vector<Slot> slots_;
+  vector<size_t> free_slots_;
+  unordered_map<const string *, size_t> slot_of_;
+  size_t hand_ = 0;
+};
+
+class LfuPolicy : public EvictionPolicy {
+public:
+  void Insert(const string *key) override;
+  void Touch(const string *key) override;
+  const string *Evict() override;
+
+private:
+  // (matches, last use) of every key, the first is evicted. The matches of a
+  // new key start at the minimum, see Insert().
+  typedef pair<uint32_t, uint64_t> Rank;
+  map<Rank, const string *> ranks_;
+  unordered_map<const string *, Rank> rank_of_;
+  uint64_t clock_ = 0;
+};
+
+// A feature index for online delta compression that keeps at most
+// max_records records or max_bytes estimated bytes resident, 0 for no limit.
+// New records look up a base among the resident records, then are inserted
+// as bases themselves, evicting the bases the policy chooses.
+class BoundedFeatureIndex {
+public:
+  BoundedFeatureIndex(EvictionPolicyType policy, size_t max_records,
+                      size_t max_bytes);
+
+  // The resident key sharing the most super features, false if there is
+  // none. A found base is touched in the eviction policy.
+  bool FindBase(const SuperFeatures &super_features, string *base_key);
+
+  // Insert or replace key, then evict until the budgets are met
+  void Insert(const string &key, const SuperFeatures &super_features);
+
+  size_t Size() const { return entries_.size(); }
+  size_t Bytes() const { return bytes_; }
+  size_t Evictions() const { return evictions_; }
+
+  // Estimated heap bytes of one record: the entry with its key and super
+  // features, and a node in the posting set of every super feature
+  static size_t EntryBytes(const string &key,
+                           const SuperFeatures &super_features);
+
+private:
+  struct Entry {
+    SuperFeatures super_features;
+    size_t bytes;
+  };
+
+  void Erase(const string *key);
+
+  unordered_map<string, Entry> entries_;
+  unordered_map<super_feature_t, unordered_set<const string *>> postings_;
+  unique_ptr<EvictionPolicy> policy_;
+  const size_t kMaxRecords;
+  const size_t kMaxBytes;
+  size_t bytes_ = 0;
+  size_t evictions_ = 0;
+};
+
+// One budget and policy of the bounded index on a data set
+struct BoundedIndexResult {
+  string policy;
+  // percent of the records or bytes of the unbounded index
+  size_t budget_percent = 0;
+  size_t max_records = 0;
+  size_t max_bytes = 0;
+
+  size_t lookups = 0;
+  size_t hits = 0;
+  size_t evictions = 0;
+  size_t peak_bytes = 0;
+  // all records to the records stored as good deltas against the found
+  // bases or as they are
+  uintmax_t original_size = 0;
+  uintmax_t stored_size = 0;
+  // ratio of the unbounded index, set by the caller
+  double unbounded_ratio = 0;
+
+  // table "bounded index"
+  ResultRow ToRow() const;
+};
@@ -0,0 +1,74 @@
+#include "cluster_dictionary.h"
+#include <cstdint>
+#include <cstring>
+
+static const size_t kGramSize = 8;
+// Only 1/4 of the 8-grams are sampled, chosen by content so that the same
+// grams are sampled in the base and in the members.
+static const uint64_t kGramSampleMask = 3;
+
+static inline uint64_t HashGram(const char *p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v * 0x9E3779B97F4A7C15ULL;
+}
+
+// A one-hash Bloom filter of the sampled 8-grams in the dictionary
+class GramFilter {
+public:
+  explicit GramFilter(size_t dictionary_size) {
+    size_t bits = 64;
+    while (bits < dictionary_size * 2)
+      bits <<= 1;
+    mask_ = bits - 1;
+    bitmap_.assign(bits / 64, 0);
+  }
+
+  void Add(const char *p, size_t size) {
+    for (size_t i = 0; i + kGramSize <= size; ++i) {
+      uint64_t h = HashGram(p + i);
+      if (((h >> 60) & kGramSampleMask) == 0)
+        bitmap_[(h & mask_) / 64] |= 1ULL << (h & 63);
+    }
+  }
+
+  // A chunk is new if less than half of its sampled 8-grams are already in
+  // the dictionary.
+  bool IsNew(const char *p, size_t size) const {
+    size_t total = 0, known = 0;
+    for (size_t i = 0; i + kGramSize <= size; ++i) {
+      uint64_t h = HashGram(p + i);
+      if (((h >> 60) & kGramSampleMask) == 0) {
+        ++total;
+        known += (bitmap_[(h & mask_) / 64] >> (h & 63)) & 1;
+      }
+    }
+    return total && known * 2 < total;
+  }
+
+private:
+  uint64_t mask_;
+  vector<uint64_t> bitmap_;
+};
+
+void BuildClusterDictionary(const string &base,
+                            const vector<const string *> &members,
+                            string *dictionary) {
+  const size_t limit = base.size() + kMaxDictionaryExtraSize;
+  dictionary->assign(base);
+  GramFilter grams(limit);
+  grams.Add(base.data(), base.size());
+
+  for (const string *member : members) {
+    for (size_t pos = 0; pos < member->size(); pos += kDictionaryChunkSize) {
+      size_t size = min(kDictionaryChunkSize, member->size() - pos);
+      const char *chunk = member->data() + pos;
+      if (dictionary->size() + size > limit)
+        return;
+      if (!grams.IsNew(chunk, size))
+        continue;
+      dictionary->append(chunk, size);
+      grams.Add(chunk, size);
+    }
+  }
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Small records are often similar to a whole cluster of records rather than
+// to a single base. A cluster dictionary starts with the base record found by
+// FeatureIndexTable, followed by the chunks of the other cluster members that
+// the base doesn't contain. Every member is then delta compressed against the
+// dictionary instead of the base alone.
+//
+// The dictionary is shared by the cluster, so only the bytes added after the
+// base are an extra storage cost: the base has to be stored anyway.
+
+// The dictionary grows at most this many bytes beyond the base
+const size_t kMaxDictionaryExtraSize = 32 * 1024;
+// Members are cut into chunks of this size to find content new to the base
+const size_t kDictionaryChunkSize = 128;
+
+void BuildClusterDictionary(const string &base,
+                            const vector<const string *> &members,
+                            string *dictionary);
@@ -1,5 +1,12 @@
 #pragma once
+#include "arena.h"
+#include "dataset_adapter.h"
 #include "odess_similarity_detection.h"
+#include "perf_counters.h"
+#include "phase_timer.h"
+#include "statistics.h"
+#include "synthetic_data.h"
+#include <array>
 #include <bits/types/struct_timespec.h>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
@@ -8,6 +15,7 @@
 #include <cstdint>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <unordered_map>
@@ -16,41 +24,31 @@ namespace fs = boost::filesystem;
 using namespace fs;
 using namespace std;
 
+// The records of a data set and everything the benchmark derives from them.
+// With use_arena the nodes of the containers are allocated from arena, so
+// deleting the data set doesn't free them one by one. The buffers of the key,
+// value and delta strings stay on the heap and are still freed one by one.
 struct AllData {
+  explicit AllData(const FeatureParameters &parameters = FeatureParameters(),
+                   bool use_arena = true)
+      : arena(use_arena ? new Arena() : nullptr),
+        table(parameters, arena.get()),
+        key_value(ArenaAllocator<char>(arena.get())),
+        key_compressed_delta(ArenaAllocator<char>(arena.get())),
+        basekey_similarkeys(ArenaAllocator<char>(arena.get())),
+        basekey_deltakeys(ArenaAllocator<char>(arena.get())),
+        key_self_compressed_size(ArenaAllocator<char>(arena.get())) {}
+
+  // declared first, so it is destroyed after the containers
+  unique_ptr<Arena> arena;
   FeatureIndexTable table;
-  unordered_map<string, string> key_value;
-  unordered_map<string, string> key_compressed_delta;
-  unordered_map<string, vector<string>> basekey_similarkeys;
-};
-
-struct HumanReadable {
-  uintmax_t size_;
-  HumanReadable(size_t size = 0) : size_(size){};
-  std::string ToString(bool with_byte = true) {
-    int magnitude = 0;
-    double mantissa = size_;
-    while (mantissa >= 1024) {
-      mantissa /= 1024.;
-      ++magnitude;
-    }
-
-    mantissa = ceil(mantissa * 10.) / 10.;
-
-    stringstream ss;
-    ss << fixed << setprecision(2) << mantissa;
-    string res = ss.str();
-    res += "BKMGTPE"[magnitude];
-    if (magnitude)
-      res += 'B';
-    if (magnitude && with_byte)
-      res += '(' + to_string(size_) + ')';
-    return res;
-  }
-
-private:
-  friend ostream &operator<<(ostream &os, HumanReadable hr) {
-    return os << hr.ToString();
-  }
+  ArenaHashMap<string, string> key_value;
+  ArenaHashMap<string, string> key_compressed_delta;
+  ArenaHashMap<string, vector<string>> basekey_similarkeys;
+  // the similar keys that are delta compressed by the current method
+  ArenaHashMap<string, vector<string>> basekey_deltakeys;
+  // LZ compressed size of each record, 0 if it doesn't compress well
+  ArenaHashMap<string, size_t> key_self_compressed_size;
 };
 
 enum DataSetType : uint8_t {
@@ -58,16 +56,23 @@ enum DataSetType : uint8_t {
   kEnronMail,
   kStackOverFlow,
   kStackOverFlowComment,
+  kSynthetic, // generated by SyntheticDataGenerator, needs no files
   kNumberOfDataSet
 };
 
+const static string dataset_name[kNumberOfDataSet]{
+    "wikipedia", "enron_mail", "stack_overflow", "stack_overflow_comment",
+    "synthetic"};
+
+inline string ToString(DataSetType type) { return dataset_name[type]; }
+
 const path data_path = "/home/wht/tao-db/test-titan/dataset/DataSet/";
 const path wiki_directory = data_path / "wikipedia/article";
 const path enron_email_directory = data_path / "enronMail";
 const path stack_overflow_directory = data_path / "stackExchange";
 const path stack_overflow_comment_file = data_path / "Comments.xml";
 
-string exec(const char *cmd) {
+inline string exec(const char *cmd) {
   array<char, 128> buffer;
   string result;
   unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd, "r"), pclose);
@@ -80,7 +85,7 @@ string exec(const char *cmd) {
   return result;
 }
 
-size_t CountWikipediaHtmls(void) {
+inline size_t CountWikipediaHtmls(void) {
   string cmd = "find " + wiki_directory.string() + " -name '*.html' | wc -l";
   string res = exec(cmd.c_str());
   size_t size;
@@ -88,7 +93,7 @@ size_t CountWikipediaHtmls(void) {
   return size;
 }
 
-size_t CountEnronEmails(void) {
+inline size_t CountEnronEmails(void) {
   string cmd = "find " + enron_email_directory.string() + " | wc -l";
   string res = exec(cmd.c_str());
   size_t size;
@@ -96,7 +101,7 @@ size_t CountEnronEmails(void) {
   return size;
 }
 
-size_t CountStackOverFlowXmlFiles() {
+inline size_t CountStackOverFlowXmlFiles() {
   string cmd = "find " + stack_overflow_directory.string() + " | wc -l";
   string res = exec(cmd.c_str());
   size_t size;
@@ -104,7 +109,7 @@ size_t CountStackOverFlowXmlFiles() {
   return size;
 }
 
-size_t CountLinesOfStackOverFlowComment() {
+inline size_t CountLinesOfStackOverFlowComment() {
   string cmd = "wc -l " + stack_overflow_comment_file.string();
   string res = exec(cmd.c_str());
   size_t size;
@@ -114,10 +119,31 @@ size_t CountLinesOfStackOverFlowComment() {
 
 class DataReader {
 public:
-  DataReader(size_t expected_percentage = 100)
-      : expected_percentage_(expected_percentage){};
+  DataReader(size_t expected_percentage = 100,
+             const SyntheticDataOptions &synthetic_options = {})
+      : expected_percentage_(expected_percentage),
+        synthetic_options_(synthetic_options),
+        load_phase_(phases_.Phase("load")),
+        feature_phase_(phases_.Phase("load/feature index put")),
+        insert_phase_(phases_.Phase("load/key-value insert")){};
+
+  // Returns false if the data set is not found
+  bool ReadDataPrepare(const DataSetType type) {
+    if (type == kSynthetic) {
+      to_be_read_ = synthetic_options_.record_number;
+      printf("%zu synthetic records can be put into the database\n",
+             to_be_read_);
+      return true;
+    }
+    const path directories[] = {wiki_directory, enron_email_directory,
+                                stack_overflow_directory,
+                                stack_overflow_comment_file};
+    if (type < kSynthetic && !exists(directories[type])) {
+      cerr << "data set not found: " << directories[type] << endl;
+      return false;
+    }
+
 
-  void ReadDataPrepare(const DataSetType type) {
     printf("Scaning the number of files that can be Put into the "
            "database...\n");
     printf("Please wait, this may takes a few minutes...\n");
@@ -144,11 +170,12 @@ public:
     }
     default: {
       cerr << "wrong data set type!\n";
-      return;
+      return false;
     }
     }
     printf("%zu files can be put into the database\n", to_be_read_);
     printf("Data set path = %s\n", data_directory_.c_str());
+    return true;
   }
 
   void GetSimilarRecords(const AllData &data) {
@@ -159,6 +186,8 @@ public:
     printf("\n##################################################\n");
     cout << total_records_ << " records have been put into titan databse!\n";
     cout << put_key_value_size_ << " are the size of keys and values\n";
+    if (empty_records_)
+      cout << empty_records_ << " empty records are skipped\n";
     printf("%6zu (%.2f%%) is the number of similar records that can be delta "
            "compressed\n",
            max_similar_records_,
@@ -216,9 +245,35 @@ public:
     value = move(remain_lines);
   }
 
+  // Count the hardware events of feature extraction into feature_counts_
+  void EnablePerfCounters() { perf_counters_.reset(new PerfCounters()); }
+  // Only load the records, the feature index is loaded from a snapshot
+  void DisableFeatureIndex() { index_features_ = false; }
+
   void Put(const string &key, const string &value, AllData &data) {
-    data.table.Put(key, value);
-    data.key_value[key] = value;
+    // nothing to delta compress, and the codecs don't take empty input
+    if (value.empty()) {
+      ++empty_records_;
+      return;
+    }
+    PerfCounts start, stop;
+    if (perf_counters_)
+      perf_counters_->Read(&start);
+    if (index_features_) {
+      ScopedPhaseTimer timer(feature_phase_, false);
+      timer.AddRecords(1, value.size());
+      data.table.Put(key, value);
+    }
+    if (perf_counters_) {
+      perf_counters_->Read(&stop);
+      feature_counts_.Add(start, stop);
+      feature_counts_.bytes += value.size();
+    }
+    {
+      ScopedPhaseTimer timer(insert_phase_, false);
+      timer.AddRecords(1, key.size() + value.size());
+      data.key_value[key] = value;
+    }
     ++total_records_;
     put_key_value_size_.size_ += key.size() + value.size();
   }
@@ -320,33 +375,73 @@ public:
     }
   }
 
-  void PutWikipediaData(AllData &data) {
-    ReadDataPrepare(kWikipedia);
+  bool PutWikipediaData(AllData &data) {
+    if (!ReadDataPrepare(kWikipedia))
+      return false;
     ReadFilesUnderDirectoryThenPut(kWikipedia, data);
     Finish(data);
+    return true;
   }
 
-  void PutEnronMailData(AllData &data) {
-    ReadDataPrepare(kEnronMail);
+  bool PutEnronMailData(AllData &data) {
+    if (!ReadDataPrepare(kEnronMail))
+      return false;
     ReadFilesUnderDirectoryThenPut(kEnronMail, data);
     Finish(data);
+    return true;
   }
 
-  void PutStackOverFlowData(AllData &data) {
-    ReadDataPrepare(kStackOverFlow);
+  bool PutStackOverFlowData(AllData &data) {
+    if (!ReadDataPrepare(kStackOverFlow))
+      return false;
     ReadParseStackOverFlowDataAndPut(data);
     Finish(data);
+    return true;
   }
 
-  void PutStackOverFlowCommentData(AllData &data) {
-    ReadDataPrepare(kStackOverFlowComment);
+  bool PutStackOverFlowCommentData(AllData &data) {
+    if (!ReadDataPrepare(kStackOverFlowComment))
+      return false;
     ReadParseStackOverFlowCommentFileAndPut(data);
     Finish(data);
+    return true;
+  }
+
+  bool PutAdapterData(DatasetAdapter &adapter, AllData &data) {
+    printf("Scaning the number of records in %s...\n", adapter.Name().c_str());
+    to_be_read_ = adapter.CountRecords();
+    if (to_be_read_ == 0) {
+      cerr << "data set is empty or not found: " << adapter.Name() << endl;
+      return false;
+    }
+    printf("%zu records can be put into the database\n", to_be_read_);
+    string key, value;
+    while (adapter.Next(&key, &value)) {
+      Put(key, value, data);
+      if (IsFinish())
+        break;
+    }
+    Finish(data);
+    return true;
+  }
+
+  bool PutSyntheticData(AllData &data) {
+    ReadDataPrepare(kSynthetic);
+    SyntheticDataGenerator generator(synthetic_options_);
+    string key, value;
+    while (generator.Next(&key, &value)) {
+      Put(key, value, data);
+      if (IsFinish())
+        break;
+    }
+    Finish(data);
+    return true;
   }
 
   size_t to_be_read_;
   size_t has_been_read_ = 0;
   size_t total_records_ = 0;
+  size_t empty_records_ = 0;
   size_t completion_percentage_ = 0;
   size_t last_completion_ = 0;
   // expected_percentage_ range:[1-100]
@@ -355,4 +450,13 @@ public:
   size_t max_similar_records_;
   struct HumanReadable put_key_value_size_;
   path data_directory_;
+  SyntheticDataOptions synthetic_options_;
+  unique_ptr<PerfCounters> perf_counters_;
+  PerfCounts feature_counts_;
+  bool index_features_ = true;
+  // time of every phase of the data set, from loading to the last codec
+  PhaseRegistry phases_;
+  PhaseStatistics &load_phase_;
+  PhaseStatistics &feature_phase_;
+  PhaseStatistics &insert_phase_;
 };
\ No newline at end of file
@@ -0,0 +1,239 @@
+#include "dataset_adapter.h"
+#include "util/coding.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace fs = boost::filesystem;
+
+const size_t LineDelimitedAdapter::kReadBufferSize;
+const size_t LengthPrefixedAdapter::kReadBufferSize;
+
+DirectoryTreeAdapter::DirectoryTreeAdapter(const fs::path &directory)
+    : directory_(directory) {}
+
+string DirectoryTreeAdapter::Name() const { return "dir:" + directory_.string(); }
+
+// A missing or unreadable directory counts as empty, the iteration stops at
+// the first error
+size_t DirectoryTreeAdapter::CountRecords() {
+  size_t files = 0;
+  boost::system::error_code error;
+  fs::recursive_directory_iterator f(directory_, error), end;
+  for (; !error && f != end; f.increment(error)) {
+    if (fs::is_regular_file(f->status(error)))
+      ++files;
+    error.clear();
+  }
+  if (error)
+    cerr << "can't read " << directory_ << ": " << error.message() << endl;
+  return files;
+}
+
+// Read the whole file at once, without going through a stringstream.
+// Returns false if it can't be read.
+static bool ReadWholeFile(const fs::path &file, string *value) {
+  boost::system::error_code error;
+  const uintmax_t size = fs::file_size(file, error);
+  FILE *fin = error ? nullptr : fopen(file.c_str(), "rb");
+  if (fin == nullptr) {
+    cerr << "can't open " << file << ", skipped" << endl;
+    return false;
+  }
+  value->resize(size);
+  size_t read = value->empty() ? 0 : fread(&(*value)[0], 1, value->size(), fin);
+  value->resize(read);
+  fclose(fin);
+  return true;
+}
+
+bool DirectoryTreeAdapter::Next(string *key, string *value) {
+  boost::system::error_code error;
+  fs::recursive_directory_iterator end;
+  if (!started_) {
+    it_ = fs::recursive_directory_iterator(directory_, error);
+    started_ = true;
+  } else if (it_ != end) {
+    it_.increment(error);
+  }
+  // skip directories and the files that can't be read
+  while (!error && it_ != end) {
+    const fs::path &file = it_->path();
+    if (fs::is_regular_file(it_->status(error)) && ReadWholeFile(file, value)) {
+      const string &prefix = directory_.string();
+      key->assign(file.string());
+      if (key->compare(0, prefix.size(), prefix) == 0)
+        key->erase(0, min(prefix.size() + 1, key->size()));
+      return true;
+    }
+    error.clear();
+    it_.increment(error);
+  }
+  if (error) {
+    cerr << "can't read " << directory_ << ": " << error.message() << endl;
+    it_ = end;
+  }
+  return false;
+}
+
+LineDelimitedAdapter::LineDelimitedAdapter(const fs::path &file,
+                                           char delimiter, int key_field)
+    : file_(file), delimiter_(delimiter), key_field_(key_field),
+      read_buffer_(new char[kReadBufferSize]) {
+  fin_.rdbuf()->pubsetbuf(read_buffer_.get(), kReadBufferSize);
+  fin_.open(file_, ios::binary);
+}
+
+string LineDelimitedAdapter::Name() const { return "lines:" + file_.string(); }
+
+size_t LineDelimitedAdapter::CountRecords() {
+  FILE *fin = fopen(file_.c_str(), "rb");
+  if (fin == nullptr)
+    return 0;
+  unique_ptr<char[]> buffer(new char[kReadBufferSize]);
+  size_t lines = 0, read;
+  char last = '\n';
+  while ((read = fread(buffer.get(), 1, kReadBufferSize, fin)) > 0) {
+    for (const char *p = buffer.get(), *end = p + read;
+         (p = (const char *)memchr(p, '\n', end - p)) != nullptr; ++p)
+      ++lines;
+    last = buffer[read - 1];
+  }
+  fclose(fin);
+  // the last line may have no line break
+  return lines + (last != '\n');
+}
+
+bool LineDelimitedAdapter::Next(string *key, string *value) {
+  if (!getline(fin_, *value))
+    return false;
+  ++line_number_;
+
+  if (key_field_ < 0) {
+    *key = to_string(line_number_);
+    return true;
+  }
+  size_t start = 0;
+  for (int field = 0; field < key_field_ && start != string::npos; ++field) {
+    start = value->find(delimiter_, start);
+    if (start != string::npos)
+      ++start;
+  }
+  if (start == string::npos) {
+    // the line has too few fields, fall back to the line number
+    *key = to_string(line_number_);
+    return true;
+  }
+  size_t end = value->find(delimiter_, start);
+  key->assign(*value, start, end == string::npos ? string::npos : end - start);
+  return true;
+}
+
+LengthPrefixedAdapter::LengthPrefixedAdapter(const fs::path &file)
+    : file_(file), fin_(fopen(file.c_str(), "rb")),
+      read_buffer_(new char[kReadBufferSize]) {
+  if (fin_ == nullptr)
+    cerr << "can't open " << file_ << endl;
+  else
+    setvbuf(fin_, read_buffer_.get(), _IOFBF, kReadBufferSize);
+}
+
+LengthPrefixedAdapter::~LengthPrefixedAdapter() {
+  if (fin_ != nullptr)
+    fclose(fin_);
+}
+
+string LengthPrefixedAdapter::Name() const {
+  return "records:" + file_.string();
+}
+
+bool LengthPrefixedAdapter::GetVarint32(uint32_t *value) {
+  uint32_t result = 0;
+  for (uint32_t shift = 0; shift <= 28; shift += 7) {
+    int byte = getc_unlocked(fin_);
+    if (byte == EOF)
+      return false;
+    result |= (uint32_t)(byte & 127) << shift;
+    if (!(byte & 128)) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+// fseek past the end of the file succeeds, so the end of the field is
+// checked against the file size
+bool LengthPrefixedAdapter::Skip(uint32_t length, off_t file_size) {
+  off_t position = ftello(fin_);
+  return position >= 0 && position + (off_t)length <= file_size &&
+         fseeko(fin_, length, SEEK_CUR) == 0;
+}
+
+// Only the length fields are read, the keys and values are skipped. A
+// truncated record at the end is not counted, Next() doesn't return it.
+size_t LengthPrefixedAdapter::CountRecords() {
+  if (fin_ == nullptr || fseeko(fin_, 0, SEEK_END) != 0)
+    return 0;
+  const off_t file_size = ftello(fin_);
+  rewind(fin_);
+  size_t records = 0;
+  uint32_t key_length, value_length;
+  while (GetVarint32(&key_length) && Skip(key_length, file_size) &&
+         GetVarint32(&value_length) && Skip(value_length, file_size))
+    ++records;
+  rewind(fin_);
+  return records;
+}
+
+bool LengthPrefixedAdapter::Next(string *key, string *value) {
+  if (fin_ == nullptr)
+    return false;
+  uint32_t key_length, value_length;
+  if (!GetVarint32(&key_length))
+    return false;
+  key->resize(key_length);
+  if (key_length && fread(&(*key)[0], 1, key_length, fin_) != key_length)
+    return false;
+  if (!GetVarint32(&value_length))
+    return false;
+  value->resize(value_length);
+  if (value_length && fread(&(*value)[0], 1, value_length, fin_) != value_length)
+    return false;
+  return true;
+}
+
+void PutLengthPrefixedRecord(string *dst, const string &key,
+                             const string &value) {
+  PutVarint32(dst, key.size());
+  dst->append(key);
+  PutVarint32(dst, value.size());
+  dst->append(value);
+}
+
+unique_ptr<DatasetAdapter> NewDatasetAdapter(const string &spec) {
+  size_t colon = spec.find(':');
+  if (colon == string::npos)
+    return nullptr;
+  string type = spec.substr(0, colon);
+  string location = spec.substr(colon + 1);
+
+  if (type == "dir")
+    return unique_ptr<DatasetAdapter>(new DirectoryTreeAdapter(location));
+  if (type == "records")
+    return unique_ptr<DatasetAdapter>(new LengthPrefixedAdapter(location));
+  if (type == "lines") {
+    // lines:<file>:<delimiter>:<key field>, the delimiter is one character
+    char delimiter = '\t';
+    int key_field = -1;
+    size_t last = location.rfind(':');
+    if (last != string::npos && last >= 2 && location[last - 2] == ':') {
+      delimiter = location[last - 1];
+      key_field = atoi(location.c_str() + last + 1);
+      location.resize(last - 2);
+    }
+    return unique_ptr<DatasetAdapter>(
+        new LineDelimitedAdapter(location, delimiter, key_field));
+  }
+  return nullptr;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+
+using namespace std;
+
+// A data set adapter reads (key, value) records from a storage layout, so any
+// key-value dump can run through the same similarity detection and delta
+// compression pipeline as the built-in data sets.
+//
+// Adapters are created from a spec string by NewDatasetAdapter():
+//   dir:<directory>                       every file under the directory
+//   lines:<file>[:<delimiter>:<key field>] one record per line
+//   records:<file>                        length prefixed binary records
+class DatasetAdapter {
+public:
+  virtual ~DatasetAdapter() {}
+
+  virtual string Name() const = 0;
+
+  // Scan the data set to count the records, used to report progress.
+  virtual size_t CountRecords() = 0;
+
+  // Returns false when there are no more records
+  virtual bool Next(string *key, string *value) = 0;
+};
+
+// key: path of the file relative to the directory
+// value: file content
+class DirectoryTreeAdapter : public DatasetAdapter {
+public:
+  explicit DirectoryTreeAdapter(const boost::filesystem::path &directory);
+
+  string Name() const override;
+  size_t CountRecords() override;
+  bool Next(string *key, string *value) override;
+
+private:
+  const boost::filesystem::path directory_;
+  boost::filesystem::recursive_directory_iterator it_;
+  bool started_ = false;
+};
+
+// value: one line of the file
+// key: the key_field-th field of the line split by delimiter (counting from
+// 0), or the line number if key_field is negative
+class LineDelimitedAdapter : public DatasetAdapter {
+public:
+  LineDelimitedAdapter(const boost::filesystem::path &file, char delimiter,
+                       int key_field);
+
+  string Name() const override;
+  size_t CountRecords() override;
+  bool Next(string *key, string *value) override;
+
+private:
+  static const size_t kReadBufferSize = 1 << 20;
+
+  const boost::filesystem::path file_;
+  const char delimiter_;
+  const int key_field_;
+  // declared before fin_, so it is freed after the stream
+  unique_ptr<char[]> read_buffer_;
+  boost::filesystem::ifstream fin_;
+  size_t line_number_ = 0;
+};
+
+// Binary record log, records are stored one after another:
+//
+//    +------------+-----+--------------+-------+
+//    | key length | key | value length | value |
+//    +------------+-----+--------------+-------+
+//    |  Varint32  |     |   Varint32   |       |
+//    +------------+-----+--------------+-------+
+class LengthPrefixedAdapter : public DatasetAdapter {
+public:
+  explicit LengthPrefixedAdapter(const boost::filesystem::path &file);
+  ~LengthPrefixedAdapter() override;
+
+  string Name() const override;
+  size_t CountRecords() override;
+  bool Next(string *key, string *value) override;
+
+private:
+  static const size_t kReadBufferSize = 1 << 20;
+
+  bool GetVarint32(uint32_t *value);
+  // Seek over a key or value, false if it ends after file_size
+  bool Skip(uint32_t length, off_t file_size);
+
+  const boost::filesystem::path file_;
+  FILE *fin_;
+  unique_ptr<char[]> read_buffer_;
+};
+
+// Append a record in the LengthPrefixedAdapter format
+void PutLengthPrefixedRecord(string *dst, const string &key,
+                             const string &value);
+
+// Returns nullptr if the spec is not recognized
+unique_ptr<DatasetAdapter> NewDatasetAdapter(const string &spec);
@@ -33,8 +33,9 @@ bool DeltaCompress(DeltaCompressType type, const string &input,
 
   const size_t kMaxOutLen = input.length() * 2;
   char *buff = new char[kMaxOutLen];
-  size_t outlen;
-  bool ok;
+  // Some codecs only write the low 32 bits through a uint32_t pointer
+  size_t outlen = 0;
+  bool ok = false;
 
   uint32_t original_length = input.size();
   PutVarint32(output, original_length);
@@ -176,9 +177,67 @@ bool DeltaUncompress(DeltaCompressType type, const string &delta,
     ok = false;
   }
 
-  delete[] buff;
-
   if(ok)
     output->assign(buff, buff + output_size);
+
+  delete[] buff;
   return ok;
-}
\ No newline at end of file
+}
+
+static void ConcatenateBases(const vector<const string *> &bases,
+                             string *virtual_base) {
+  size_t size = 0;
+  for (const string *base : bases)
+    size += base->size();
+  virtual_base->reserve(size);
+  for (const string *base : bases)
+    virtual_base->append(*base);
+}
+
+bool DeltaCompress(DeltaCompressType type, const string &input,
+                   const vector<const string *> &bases, string *output) {
+  if (bases.empty())
+    return false;
+
+  string virtual_base;
+  ConcatenateBases(bases, &virtual_base);
+  if (virtual_base.size() > numeric_limits<uint32_t>::max())
+    return false;
+
+  size_t segment_table_size = output->size();
+  PutVarint32(output, bases.size());
+  for (const string *base : bases)
+    PutVarint32(output, base->size());
+  segment_table_size = output->size() - segment_table_size;
+
+  size_t delta_start = output->size();
+  bool ok = DeltaCompress(type, input, virtual_base, output);
+  // The segment table is part of the compressed size
+  size_t delta_size = output->size() - delta_start;
+  return ok && GoodCompressionRatio(segment_table_size + delta_size,
+                                    input.size());
+}
+
+bool DeltaUncompress(DeltaCompressType type, const string &delta,
+                     const vector<const string *> &bases, string *output) {
+  const char *p = delta.data();
+  const char *limit = p + delta.size();
+  uint32_t base_number;
+  p = GetVarint32Ptr(p, limit, &base_number);
+  if (p == nullptr || base_number != bases.size()) {
+    cerr << "Currupted multi-base delta compression" << endl;
+    return false;
+  }
+  for (const string *base : bases) {
+    uint32_t base_length;
+    p = GetVarint32Ptr(p, limit, &base_length);
+    if (p == nullptr || base_length != base->size()) {
+      cerr << "multi-base delta compression bases mismatch" << endl;
+      return false;
+    }
+  }
+
+  string virtual_base;
+  ConcatenateBases(bases, &virtual_base);
+  return DeltaUncompress(type, string(p, limit), virtual_base, output);
+}
@@ -1,5 +1,7 @@
+#pragma once
 #include <cstdint>
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -27,6 +29,9 @@ const static string name[kNumberOfDeltaCompression]{
 
 inline string ToString(DeltaCompressType type) { return name[type]; }
 
+// Returns true if the compressed size saves at least 12.5% of the raw size.
+bool GoodCompressionRatio(size_t compressed_size, size_t raw_size);
+
 // Returns true if:
 // (1) the compression method is supported in this platform and
 // (2) the compression rate is "good enough".
@@ -35,4 +40,26 @@ bool DeltaCompress(DeltaCompressType type, const string &input,
 
 // Return true if success
 bool DeltaUncompress(DeltaCompressType type, const string &delta,
-                     const string &base, string *output);
\ No newline at end of file
+                     const string &base, string *output);
+
+// Multi-base delta compression. The input can COPY from several similar
+// records: the bases are concatenated into one virtual base, and the segment
+// table in front of the delta records the length of every base, so an offset
+// in the virtual base maps to a segment ID (which base) and an offset in it.
+//
+// Multi-base delta format:
+//
+//    +-------------+---------------+-----+---------------+------------------+
+//    | base number | base length 0 | ... | base length n | delta            |
+//    +-------------+---------------+-----+---------------+------------------+
+//    |   Varint32  |   Varint32    |     |   Varint32    | DeltaCompress()  |
+//    +-------------+---------------+-----+---------------+------------------+
+//
+// Returns true under the same conditions as the single base DeltaCompress().
+bool DeltaCompress(DeltaCompressType type, const string &input,
+                   const vector<const string *> &bases, string *output);
+
+// The bases must be the same records in the same order as when compressing.
+// Return true if success
+bool DeltaUncompress(DeltaCompressType type, const string &delta,
+                     const vector<const string *> &bases, string *output);
@@ -0,0 +1,255 @@
+#include "delta_compress_stream.h"
+#include "util/coding.h"
+#include "xdelta/xdelta3/xdelta3.h"
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+const size_t DeltaCompressStream::kStreamWindowSize;
+
+struct XDeltaStream {
+  xd3_stream stream;
+  xd3_config config;
+  xd3_source source;
+};
+
+// The whole base is set as a single in-memory source block, the same way
+// xd3_encode_memory does, so xdelta never asks for more source blocks.
+static unique_ptr<XDeltaStream> OpenXDeltaStream(const string &base,
+                                                 size_t winsize) {
+  unique_ptr<XDeltaStream> xdelta(new XDeltaStream);
+  memset(&xdelta->stream, 0, sizeof(xdelta->stream));
+  memset(&xdelta->config, 0, sizeof(xdelta->config));
+  memset(&xdelta->source, 0, sizeof(xdelta->source));
+
+  xdelta->config.winsize = winsize;
+  if (xd3_config_stream(&xdelta->stream, &xdelta->config) != 0) {
+    cerr << "xdelta stream config fail: " << xd3_errstring(&xdelta->stream)
+         << endl;
+    xd3_free_stream(&xdelta->stream);
+    return nullptr;
+  }
+
+  xd3_source &source = xdelta->source;
+  source.blksize = base.size();
+  source.onblk = base.size();
+  source.curblk = (const uint8_t *)base.data();
+  source.curblkno = 0;
+  source.max_winsize = base.size();
+  if (xd3_set_source_and_size(&xdelta->stream, &source, base.size()) != 0) {
+    cerr << "xdelta stream set source fail: "
+         << xd3_errstring(&xdelta->stream) << endl;
+    xd3_free_stream(&xdelta->stream);
+    return nullptr;
+  }
+  return xdelta;
+}
+
+// Run the encoder or decoder until it needs more input. Every output window
+// is appended to *output.
+static bool RunXDeltaStream(int (*process)(xd3_stream *), XDeltaStream *xdelta,
+                            string *output, size_t *produced) {
+  xd3_stream &stream = xdelta->stream;
+  while (true) {
+    int s = process(&stream);
+    switch (s) {
+    case XD3_INPUT:
+      return true;
+    case XD3_OUTPUT: {
+      output->append((const char *)stream.next_out, stream.avail_out);
+      *produced += stream.avail_out;
+      xd3_consume_output(&stream);
+      break;
+    }
+    case XD3_GOTHEADER:
+    case XD3_WINSTART:
+    case XD3_WINFINISH:
+      break;
+    default:
+      cerr << "xdelta stream fail: " << xd3_errstring(&stream) << endl;
+      return false;
+    }
+  }
+}
+
+static void CloseXDeltaStream(unique_ptr<XDeltaStream> &xdelta) {
+  if (xdelta) {
+    xd3_free_stream(&xdelta->stream);
+    xdelta.reset();
+  }
+}
+
+DeltaCompressStream::DeltaCompressStream(DeltaCompressType type,
+                                         const string &base,
+                                         size_t input_length)
+    : type_(type), base_(base), input_length_(input_length) {
+  if (type_ == kNoDeltaCompression || base_.empty() || input_length_ == 0) {
+    ok_ = false;
+    return;
+  }
+  if (input_length_ > UINT32_MAX) {
+    cerr << "can't delta compress " << input_length_
+         << " bytes, the limit is 4GiB" << endl;
+    ok_ = false;
+    return;
+  }
+  if (type_ != kXDelta)
+    return;
+
+  xdelta_ = OpenXDeltaStream(base_, min(input_length_, kStreamWindowSize));
+  ok_ = xdelta_ != nullptr;
+  PutVarint32(&pending_, input_length_);
+}
+
+DeltaCompressStream::~DeltaCompressStream() { CloseXDeltaStream(xdelta_); }
+
+bool DeltaCompressStream::Push(const char *data, size_t size) {
+  if (!ok_)
+    return false;
+  if (size > input_length_ - pushed_) {
+    cerr << "push more than " << input_length_ << " bytes to delta stream"
+         << endl;
+    ok_ = false;
+    return false;
+  }
+  pushed_ += size;
+
+  if (!xdelta_) {
+    buffered_input_.append(data, size);
+    return true;
+  }
+  xd3_avail_input(&xdelta_->stream, (const uint8_t *)data, size);
+  ok_ = RunXDeltaStream(xd3_encode_input, xdelta_.get(), &pending_,
+                        &produced_);
+  return ok_;
+}
+
+bool DeltaCompressStream::Finish() {
+  if (!ok_ || pushed_ != input_length_) {
+    ok_ = false;
+    return false;
+  }
+
+  if (!xdelta_) {
+    string output;
+    ok_ = DeltaCompress(type_, buffered_input_, base_, &output);
+    string().swap(buffered_input_);
+    pending_.append(output);
+    return ok_;
+  }
+
+  xd3_stream &stream = xdelta_->stream;
+  xd3_set_flags(&stream, stream.flags | XD3_FLUSH);
+  xd3_avail_input(&stream, (const uint8_t *)base_.data(), 0);
+  ok_ = RunXDeltaStream(xd3_encode_input, xdelta_.get(), &pending_,
+                        &produced_) &&
+        GoodCompressionRatio(produced_, input_length_);
+  CloseXDeltaStream(xdelta_);
+  return ok_;
+}
+
+bool DeltaCompressStream::Pull(string *chunk) {
+  if (pending_.empty())
+    return false;
+  chunk->clear();
+  chunk->swap(pending_);
+  return true;
+}
+
+DeltaUncompressStream::DeltaUncompressStream(DeltaCompressType type,
+                                             const string &base)
+    : type_(type), base_(base) {
+  if (type_ == kNoDeltaCompression || base_.empty()) {
+    ok_ = false;
+    return;
+  }
+  if (type_ != kXDelta)
+    return;
+
+  xdelta_ = OpenXDeltaStream(base_, 0);
+  ok_ = xdelta_ != nullptr;
+}
+
+DeltaUncompressStream::~DeltaUncompressStream() { CloseXDeltaStream(xdelta_); }
+
+// Consume the Varint32 original length in front of the delta. It may be split
+// between several pushed chunks. Returns false if the header is corrupted.
+bool DeltaUncompressStream::ParseHeader(const char **data, size_t *size) {
+  while (*size > 0 && !has_header_) {
+    header_.push_back(**data);
+    ++*data;
+    --*size;
+    const char *p = header_.data();
+    if (GetVarint32Ptr(p, p + header_.size(), &original_length_) != nullptr) {
+      has_header_ = true;
+    } else if (header_.size() >= 5) {
+      cerr << "Currupted delta compression" << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool DeltaUncompressStream::Push(const char *data, size_t size) {
+  if (!ok_)
+    return false;
+
+  if (!xdelta_) {
+    buffered_delta_.append(data, size);
+    return true;
+  }
+
+  if (!has_header_) {
+    ok_ = ParseHeader(&data, &size);
+    if (!ok_ || size == 0)
+      return ok_;
+  }
+  xd3_avail_input(&xdelta_->stream, (const uint8_t *)data, size);
+  ok_ = RunXDeltaStream(xd3_decode_input, xdelta_.get(), &pending_,
+                        &produced_);
+  if (ok_ && produced_ > original_length_) {
+    cerr << "output_size=" << produced_
+         << " original_length=" << original_length_ << endl;
+    ok_ = false;
+  }
+  return ok_;
+}
+
+bool DeltaUncompressStream::Finish() {
+  if (!ok_)
+    return false;
+
+  if (!xdelta_) {
+    string output;
+    ok_ = DeltaUncompress(type_, buffered_delta_, base_, &output);
+    string().swap(buffered_delta_);
+    pending_.append(output);
+    return ok_;
+  }
+
+  if (!has_header_) {
+    cerr << "Currupted delta compression" << endl;
+    ok_ = false;
+    return false;
+  }
+  xd3_stream &stream = xdelta_->stream;
+  xd3_set_flags(&stream, stream.flags | XD3_FLUSH);
+  xd3_avail_input(&stream, (const uint8_t *)base_.data(), 0);
+  ok_ = RunXDeltaStream(xd3_decode_input, xdelta_.get(), &pending_,
+                        &produced_);
+  if (ok_ && produced_ != original_length_) {
+    cerr << "output_size=" << produced_
+         << " original_length=" << original_length_ << endl;
+    ok_ = false;
+  }
+  CloseXDeltaStream(xdelta_);
+  return ok_;
+}
+
+bool DeltaUncompressStream::Pull(string *chunk) {
+  if (pending_.empty())
+    return false;
+  chunk->clear();
+  chunk->swap(pending_);
+  return true;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include "delta_compress.h"
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+struct XDeltaStream;
+
+// Incremental delta compression. The input is pushed chunk by chunk while it
+// is still being received, and delta bytes are pulled as soon as the codec
+// emits them.
+//
+// kXDelta encodes window by window through the xd3_stream API, so a stream
+// only holds the base plus one codec window (kStreamWindowSize). The other
+// codecs need the whole input at once: their input is buffered and compressed
+// in Finish().
+//
+// The concatenation of all pulled chunks has the same format as the output of
+// DeltaCompress(), so it can be decoded by DeltaUncompress() as well.
+class DeltaCompressStream {
+public:
+  static const size_t kStreamWindowSize = 1 << 20;
+
+  // input_length is the total size of the input that will be pushed, it is
+  // written into the delta header before the input is seen. Inputs over 4GiB
+  // don't fit the Varint32 of the header and are rejected.
+  // base must outlive the stream.
+  DeltaCompressStream(DeltaCompressType type, const string &base,
+                      size_t input_length);
+  ~DeltaCompressStream();
+
+  // Returns false if the codec fails or more than input_length bytes are
+  // pushed. The stream can not be used after a failure.
+  bool Push(const char *data, size_t size);
+
+  // Signal the end of the input.
+  // Returns true under the same conditions as DeltaCompress().
+  bool Finish();
+
+  // Move the delta bytes produced so far into *chunk.
+  // Returns false if there is nothing to pull.
+  bool Pull(string *chunk);
+
+private:
+  const DeltaCompressType type_;
+  const string &base_;
+  const size_t input_length_;
+  size_t pushed_ = 0;
+  size_t produced_ = 0;
+  bool ok_ = true;
+  string buffered_input_;
+  string pending_;
+  unique_ptr<XDeltaStream> xdelta_;
+};
+
+// Incremental counterpart of DeltaUncompress(). Delta chunks are pushed as
+// they arrive and the reconstructed record is pulled chunk by chunk.
+class DeltaUncompressStream {
+public:
+  // base must outlive the stream.
+  DeltaUncompressStream(DeltaCompressType type, const string &base);
+  ~DeltaUncompressStream();
+
+  // Returns false if the delta is corrupted or the codec fails.
+  bool Push(const char *data, size_t size);
+
+  // Signal the end of the delta.
+  // Returns true if the whole record is reconstructed.
+  bool Finish();
+
+  // Move the record bytes produced so far into *chunk.
+  // Returns false if there is nothing to pull.
+  bool Pull(string *chunk);
+
+private:
+  bool ParseHeader(const char **data, size_t *size);
+
+  const DeltaCompressType type_;
+  const string &base_;
+  bool has_header_ = false;
+  uint32_t original_length_ = 0;
+  size_t produced_ = 0;
+  bool ok_ = true;
+  string header_;
+  string buffered_delta_;
+  string pending_;
+  unique_ptr<XDeltaStream> xdelta_;
+};
+
+// Push from in chunks of chunk_size bytes into a DeltaCompressStream or a
+// DeltaUncompressStream and append everything it produces to *to.
+// Returns false if a Push() or Finish() fails.
+template <typename Stream>
+bool RunStream(Stream &stream, const string &from, size_t chunk_size,
+               string *to) {
+  string chunk;
+  for (size_t i = 0; i < from.size(); i += chunk_size) {
+    if (!stream.Push(from.data() + i, min(chunk_size, from.size() - i)))
+      return false;
+    while (stream.Pull(&chunk))
+      to->append(chunk);
+  }
+  bool ok = stream.Finish();
+  while (stream.Pull(&chunk))
+    to->append(chunk);
+  return ok;
+}
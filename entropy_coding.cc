@@ -0,0 +1,251 @@
+#include "entropy_coding.h"
+#include "util/coding.h"
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <queue>
+#include <vector>
+
+static const size_t kSymbolNumber = 256;
+static const size_t kSymbolBitmapSize = kSymbolNumber / 8;
+// Code lengths are stored in 4 bits
+static const int kMaxCodeLength = 15;
+
+// Build the Huffman code lengths of all symbols. If the tree is deeper than
+// kMaxCodeLength, the frequencies are flattened and the tree is rebuilt.
+static void BuildCodeLengths(vector<uint64_t> freq, uint8_t *lengths) {
+  typedef pair<uint64_t, size_t> Node;
+  while (true) {
+    priority_queue<Node, vector<Node>, greater<Node>> heap;
+    // internal nodes start from kSymbolNumber, so parent 0 marks the root
+    vector<size_t> parent(kSymbolNumber, 0);
+    for (size_t s = 0; s < kSymbolNumber; ++s) {
+      lengths[s] = 0;
+      if (freq[s])
+        heap.push(Node(freq[s], s));
+    }
+    if (heap.size() == 1) {
+      lengths[heap.top().second] = 1;
+      return;
+    }
+
+    while (heap.size() > 1) {
+      Node a = heap.top();
+      heap.pop();
+      Node b = heap.top();
+      heap.pop();
+      size_t id = parent.size();
+      parent.push_back(0);
+      parent[a.second] = id;
+      parent[b.second] = id;
+      heap.push(Node(a.first + b.first, id));
+    }
+
+    int max_length = 0;
+    for (size_t s = 0; s < kSymbolNumber; ++s) {
+      if (!freq[s])
+        continue;
+      int length = 0;
+      for (size_t n = s; parent[n] != 0; n = parent[n])
+        ++length;
+      lengths[s] = length;
+      max_length = max(max_length, length);
+    }
+    if (max_length <= kMaxCodeLength)
+      return;
+
+    for (size_t s = 0; s < kSymbolNumber; ++s) {
+      if (freq[s])
+        freq[s] = (freq[s] >> 1) | 1;
+    }
+  }
+}
+
+// Canonical Huffman code: shorter codes come first, codes of the same length
+// are ordered by symbol. So only the code lengths need to be stored.
+static void AssignCanonicalCodes(const uint8_t *lengths, uint32_t *codes) {
+  uint32_t count[kMaxCodeLength + 1] = {0};
+  for (size_t s = 0; s < kSymbolNumber; ++s)
+    ++count[lengths[s]];
+  count[0] = 0;
+
+  uint32_t next_code[kMaxCodeLength + 1] = {0};
+  uint32_t code = 0;
+  for (int length = 1; length <= kMaxCodeLength; ++length) {
+    code = (code + count[length - 1]) << 1;
+    next_code[length] = code;
+  }
+  for (size_t s = 0; s < kSymbolNumber; ++s) {
+    if (lengths[s])
+      codes[s] = next_code[lengths[s]]++;
+  }
+}
+
+static void PutStored(const string &input, size_t start, string *output) {
+  output->resize(start);
+  output->push_back((char)kEntropyStored);
+  output->append(input);
+}
+
+bool EntropyCompress(const string &input, string *output) {
+  const size_t start = output->size();
+  if (input.empty() || input.size() > numeric_limits<uint32_t>::max()) {
+    PutStored(input, start, output);
+    return false;
+  }
+
+  vector<uint64_t> freq(kSymbolNumber, 0);
+  for (unsigned char c : input)
+    ++freq[c];
+
+  uint8_t lengths[kSymbolNumber];
+  uint32_t codes[kSymbolNumber];
+  BuildCodeLengths(freq, lengths);
+  AssignCanonicalCodes(lengths, codes);
+
+  size_t symbols = 0;
+  uint64_t bits = 0;
+  for (size_t s = 0; s < kSymbolNumber; ++s) {
+    if (lengths[s]) {
+      ++symbols;
+      bits += freq[s] * lengths[s];
+    }
+  }
+  size_t coded_size = 1 + 5 + kSymbolBitmapSize + (symbols + 1) / 2 +
+                      (bits + 7) / 8;
+  if (coded_size >= input.size() + 1) {
+    PutStored(input, start, output);
+    return false;
+  }
+
+  output->push_back((char)kEntropyHuffman);
+  PutVarint32(output, input.size());
+
+  char bitmap[kSymbolBitmapSize] = {0};
+  for (size_t s = 0; s < kSymbolNumber; ++s) {
+    if (lengths[s])
+      bitmap[s / 8] |= 1 << (s % 8);
+  }
+  output->append(bitmap, kSymbolBitmapSize);
+
+  // two code lengths per byte, in symbol order
+  uint8_t packed = 0;
+  bool high = false;
+  for (size_t s = 0; s < kSymbolNumber; ++s) {
+    if (!lengths[s])
+      continue;
+    if (high) {
+      output->push_back((char)(packed | (lengths[s] << 4)));
+    } else {
+      packed = lengths[s];
+    }
+    high = !high;
+  }
+  if (high)
+    output->push_back((char)packed);
+
+  // MSB first bitstream
+  uint64_t buffer = 0;
+  int buffered_bits = 0;
+  for (unsigned char c : input) {
+    buffer = (buffer << lengths[c]) | codes[c];
+    buffered_bits += lengths[c];
+    while (buffered_bits >= 8) {
+      buffered_bits -= 8;
+      output->push_back((char)(buffer >> buffered_bits));
+    }
+  }
+  if (buffered_bits)
+    output->push_back((char)(buffer << (8 - buffered_bits)));
+  return true;
+}
+
+bool EntropyUncompress(const string &input, string *output) {
+  if (input.empty())
+    return false;
+
+  const char *p = input.data();
+  const char *limit = p + input.size();
+  uint8_t method = *p++;
+  if (method == kEntropyStored) {
+    output->assign(p, limit);
+    return true;
+  }
+  if (method != kEntropyHuffman) {
+    cerr << "bad entropy coding method" << endl;
+    return false;
+  }
+
+  uint32_t original_length;
+  p = GetVarint32Ptr(p, limit, &original_length);
+  if (p == nullptr || limit - p < (ptrdiff_t)kSymbolBitmapSize) {
+    cerr << "Currupted entropy coding" << endl;
+    return false;
+  }
+  const uint8_t *bitmap = (const uint8_t *)p;
+  p += kSymbolBitmapSize;
+
+  uint8_t lengths[kSymbolNumber] = {0};
+  bool high = false;
+  for (size_t s = 0; s < kSymbolNumber; ++s) {
+    if (!(bitmap[s / 8] & (1 << (s % 8))))
+      continue;
+    if (p == limit) {
+      cerr << "Currupted entropy coding" << endl;
+      return false;
+    }
+    uint8_t packed = *p;
+    lengths[s] = high ? packed >> 4 : packed & 0xf;
+    if (high)
+      ++p;
+    high = !high;
+    if (lengths[s] == 0) {
+      cerr << "Currupted entropy coding" << endl;
+      return false;
+    }
+  }
+  if (high)
+    ++p;
+
+  // count[l] symbols have code length l, sorted_symbols is in canonical order
+  int count[kMaxCodeLength + 1] = {0};
+  int offset[kMaxCodeLength + 2] = {0};
+  for (size_t s = 0; s < kSymbolNumber; ++s)
+    ++count[lengths[s]];
+  count[0] = 0;
+  for (int length = 1; length <= kMaxCodeLength; ++length)
+    offset[length + 1] = offset[length] + count[length];
+  uint8_t sorted_symbols[kSymbolNumber];
+  for (size_t s = 0; s < kSymbolNumber; ++s) {
+    if (lengths[s])
+      sorted_symbols[offset[lengths[s]]++] = s;
+  }
+
+  const uint8_t *stream = (const uint8_t *)p;
+  const uint64_t total_bits = (uint64_t)(limit - p) * 8;
+  uint64_t pos = 0;
+  output->resize(original_length);
+  for (uint32_t i = 0; i < original_length; ++i) {
+    int code = 0, first = 0, index = 0, length = 1;
+    for (; length <= kMaxCodeLength; ++length) {
+      if (pos == total_bits) {
+        cerr << "Currupted entropy coding" << endl;
+        return false;
+      }
+      code |= (stream[pos >> 3] >> (7 - (pos & 7))) & 1;
+      ++pos;
+      if (code - count[length] < first) {
+        (*output)[i] = sorted_symbols[index + (code - first)];
+        break;
+      }
+      index += count[length];
+      first = (first + count[length]) << 1;
+      code <<= 1;
+    }
+    if (length > kMaxCodeLength) {
+      cerr << "Currupted entropy coding" << endl;
+      return false;
+    }
+  }
+  return true;
+}
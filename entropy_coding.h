@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+// Optional second stage after delta compression. The whole delta is entropy
+// coded with one order-0 canonical Huffman code: the instructions and the
+// literals of the codec share a table, they are not split into streams. It
+// mostly pays off on the literals of text records such as HTML and XML.
+//
+// Entropy coded format:
+//
+//    +--------+-----------------+-----------------+--------------+-----------+
+//    | method | original_length | symbol bitmap   | code lengths | bitstream |
+//    +--------+-----------------+-----------------+--------------+-----------+
+//    | 1 byte |     Varint32    | 32 bytes        | 4 bits/symbol|           |
+//    +--------+-----------------+-----------------+--------------+-----------+
+//
+// If the Huffman code doesn't make the input smaller, the method byte is
+// kEntropyStored and it is followed by the input as is.
+enum EntropyCodingMethod : uint8_t {
+  kEntropyStored = 0,
+  kEntropyHuffman = 1,
+};
+
+// Returns true if the Huffman coded output is smaller than the input.
+// Otherwise the input is stored. In both cases the output can be decoded by
+// EntropyUncompress().
+bool EntropyCompress(const string &input, string *output);
+
+// Return true if success
+bool EntropyUncompress(const string &input, string *output);
@@ -0,0 +1,176 @@
+#include "lz_compress.h"
+#include "delta_compress.h"
+#include "util/coding.h"
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+static const size_t kMinMatch = 4;
+static const size_t kMaxOffset = 65535;
+static const int kHashLog = 14;
+static const size_t kLengthMask = 15;
+
+static inline uint32_t Read32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint32_t HashPosition(const uint8_t *p) {
+  return (Read32(p) * 2654435761U) >> (32 - kHashLog);
+}
+
+static void PutLength(string *output, size_t length) {
+  while (length >= 255) {
+    output->push_back((char)255);
+    length -= 255;
+  }
+  output->push_back((char)length);
+}
+
+static void PutSequence(string *output, const uint8_t *literals,
+                        size_t literal_length, size_t offset,
+                        size_t match_length) {
+  size_t lit_code = min(literal_length, kLengthMask);
+  size_t match_code =
+      match_length ? min(match_length - kMinMatch, kLengthMask) : 0;
+  output->push_back((char)((lit_code << 4) | match_code));
+  if (lit_code == kLengthMask)
+    PutLength(output, literal_length - kLengthMask);
+  output->append((const char *)literals, literal_length);
+  if (!match_length)
+    return;
+  output->push_back((char)(offset & 0xff));
+  output->push_back((char)(offset >> 8));
+  if (match_code == kLengthMask)
+    PutLength(output, match_length - kMinMatch - kLengthMask);
+}
+
+bool LZCompress(const string &input, string *output) {
+  if (input.empty() || input.size() > numeric_limits<uint32_t>::max())
+    return false;
+
+  const size_t start_size = output->size();
+  PutVarint32(output, input.size());
+
+  const uint8_t *in = (const uint8_t *)input.data();
+  const uint8_t *end = in + input.size();
+  const uint8_t *ip = in;
+  const uint8_t *anchor = in;
+  vector<uint32_t> table(1 << kHashLog, 0);
+
+  while (ip + kMinMatch <= end) {
+    uint32_t h = HashPosition(ip);
+    const uint8_t *candidate = in + table[h];
+    table[h] = ip - in;
+    if (candidate >= ip || (size_t)(ip - candidate) > kMaxOffset ||
+        Read32(candidate) != Read32(ip)) {
+      // Skip faster through data that doesn't match
+      ip += 1 + ((ip - anchor) >> 6);
+      continue;
+    }
+
+    size_t match_length = kMinMatch;
+    while (ip + match_length < end &&
+           candidate[match_length] == ip[match_length])
+      ++match_length;
+    while (ip > anchor && candidate > in && ip[-1] == candidate[-1]) {
+      --ip;
+      --candidate;
+      ++match_length;
+    }
+
+    PutSequence(output, anchor, ip - anchor, ip - candidate, match_length);
+    ip += match_length;
+    anchor = ip;
+    if (ip + kMinMatch <= end)
+      table[HashPosition(ip - 2)] = ip - 2 - in;
+  }
+  if (anchor < end)
+    PutSequence(output, anchor, end - anchor, 0, 0);
+
+  return GoodCompressionRatio(output->size() - start_size, input.size());
+}
+
+static bool GetLength(const uint8_t **p, const uint8_t *limit,
+                      size_t *length) {
+  uint8_t byte;
+  do {
+    if (*p == limit)
+      return false;
+    byte = *(*p)++;
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+bool LZUncompress(const string &input, string *output) {
+  const char *data = input.data();
+  const char *data_limit = data + input.size();
+  uint32_t original_length;
+  data = GetVarint32Ptr(data, data_limit, &original_length);
+  if (data == nullptr) {
+    cerr << "Currupted lz compression" << endl;
+    return false;
+  }
+
+  const uint8_t *p = (const uint8_t *)data;
+  const uint8_t *limit = (const uint8_t *)data_limit;
+  string result(original_length, '\0');
+  uint8_t *out = (uint8_t *)&result[0];
+  size_t op = 0;
+  bool ok = true;
+  while (op < original_length) {
+    if (p == limit) {
+      ok = false;
+      break;
+    }
+    uint8_t token = *p++;
+    size_t literal_length = token >> 4;
+    if (literal_length == kLengthMask &&
+        !GetLength(&p, limit, &literal_length)) {
+      ok = false;
+      break;
+    }
+    if (literal_length > (size_t)(limit - p) ||
+        literal_length > original_length - op) {
+      ok = false;
+      break;
+    }
+    memcpy(out + op, p, literal_length);
+    p += literal_length;
+    op += literal_length;
+    if (op == original_length)
+      break;
+
+    if (limit - p < 2) {
+      ok = false;
+      break;
+    }
+    size_t offset = p[0] | (p[1] << 8);
+    p += 2;
+    size_t match_length = (token & kLengthMask) + kMinMatch;
+    if ((token & kLengthMask) == kLengthMask &&
+        !GetLength(&p, limit, &match_length)) {
+      ok = false;
+      break;
+    }
+    if (offset == 0 || offset > op || match_length > original_length - op) {
+      ok = false;
+      break;
+    }
+    // Matches may overlap with the bytes they produce
+    const uint8_t *match = out + op - offset;
+    for (size_t i = 0; i < match_length; ++i)
+      out[op + i] = match[i];
+    op += match_length;
+  }
+
+  if (!ok) {
+    cerr << "Currupted lz compression" << endl;
+    return false;
+  }
+  output->swap(result);
+  return true;
+}
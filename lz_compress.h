@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+
+using namespace std;
+
+// Records that have no similar base, or whose delta is not good enough, can
+// still be compressed alone. This is a small LZ77 compressor in the style of
+// LZ4: a single hash table probe per position, 64KB window and no entropy
+// coding, so it is fast enough to run on every record.
+//
+// LZ compressed format:
+//
+//    +---------------------+-----------+-----------+-----+
+//    |   original_length   | sequence  | sequence  | ... |
+//    +---------------------+-----------+-----------+-----+
+//    |       Varint32      |           |           |     |
+//    +---------------------+-----------+-----------+-----+
+//
+// sequence:
+//
+//    +-------+-----------------+----------+--------+-----------------+
+//    | token | literal length  | literals | offset |  match length   |
+//    +-------+-----------------+----------+--------+-----------------+
+//    | 1byte | 0-n bytes       |          | 2bytes | 0-n bytes       |
+//    +-------+-----------------+----------+--------+-----------------+
+//
+// The high 4 bits of token are the literal length, the low 4 bits are the
+// match length minus 4. A value of 15 is followed by extra length bytes that
+// are added up until a byte is not 255. The last sequence stops after the
+// literals.
+
+// Returns true if the compression rate is "good enough".
+bool LZCompress(const string &input, string *output);
+
+// Return true if success
+bool LZUncompress(const string &input, string *output);
@@ -1,72 +1,182 @@
+#include "base_store.h"
+#include "benchmark_options.h"
+#include "bounded_feature_index.h"
+#include "cluster_dictionary.h"
 #include "data_reader.h"
 #include "delta_compress.h"
+#include "delta_compress_stream.h"
+#include "entropy_coding.h"
+#include "lz_compress.h"
+#include "numa.h"
+#include "memory_usage.h"
 #include "odess_similarity_detection.h"
+#include "online_store.h"
+#include "oracle.h"
+#include "partitioned_index.h"
+#include "perf_counters.h"
+#include "phase_timer.h"
+#include "read_replay.h"
+#include "statistics.h"
+#include "sweep.h"
+#include "task_scheduler.h"
 #include "gdelta_init/gdelta_init.h"
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <cstdio>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
 
 using namespace std;
 
-void AddElapsedTime(timespec &time, const timespec &start,
-                    const timespec &stop) {
-  time.tv_nsec += stop.tv_nsec - start.tv_nsec;
-  time.tv_sec += stop.tv_sec - start.tv_sec;
-  if (time.tv_nsec < 0) {
-    time.tv_nsec += 1000000000;
-    time.tv_sec--;
-  }
-  if (time.tv_nsec > 1000000000) {
-    time.tv_nsec -= 1000000000;
-    time.tv_sec++;
-  }
-}
-
-double TimespecToSeconds(const timespec &time) {
-  return time.tv_sec + time.tv_nsec / 1000000000.;
-}
-
-struct Statistics {
-  DeltaCompressType type;
-  timespec compressed_time{};
-  timespec uncompressed_time{};
-  HumanReadable original_size{};
-  HumanReadable compressed_size{};
-  size_t compress_fail = 0;
-  size_t compress_success = 0;
-  size_t uncompress_fail = 0;
-
-  static void PrintHead() {
-    printf(
-        "| method           | compress success | compress fail | before "
-        "compressed | after  "
-        "compressed | compression ratio | compress time | uncompress time |\n");
-    printf("| ---------------- | ---------------- | ------------- | "
-           "----------------- | "
-           "----------------- | ----------------- | ------------- | "
-           "--------------- |\n");
-  }
-
-  void Print() {
-    double ratio = (double)original_size.size_ / compressed_size.size_;
-    printf("| %s\t| %zu\t\t| %zu\t\t| %s\t\t| %s\t\t| %.2f\t\t| %.2f\t\t| "
-           "%.2f\t\t|\n",
-           ToString(type).c_str(), compress_success, compress_fail,
-           original_size.ToString(false).c_str(),
-           compressed_size.ToString(false).c_str(), ratio,
-           TimespecToSeconds(compressed_time),
-           TimespecToSeconds(uncompressed_time));
-    if (uncompress_fail)
-      printf("!!!!!   Uncompress fail %zu times   !!!!!\n", uncompress_fail);
-    fflush(stdout);
-  }
+// Read the hardware counters around every measured call, see --perf-counters
+static bool collect_perf_counters = false;
+// The counters of the current thread, nullptr if they are not collected
+static thread_local PerfCounters *thread_perf_counters = nullptr;
+
+// Time and hardware counters of the current thread at one point
+struct Sample {
+  timespec time;
+  PerfCounts counts;
 };
 
-void ScanSimilarRecords(AllData &data) {
-  cout << "scaning similar records using Odess similarity detection" << endl;
+void TakeSample(Sample *sample) {
+  clock_gettime(CLOCK_MONOTONIC, &sample->time);
+  if (thread_perf_counters)
+    thread_perf_counters->Read(&sample->counts);
+}
+
+void AddCompressSample(Statistics &stat, const Sample &start,
+                       const Sample &stop, size_t bytes) {
+  AddElapsedTime(stat.compressed_time, start.time, stop.time);
+  stat.compress_counts.Add(start.counts, stop.counts);
+  stat.compress_counts.bytes += bytes;
+}
+
+void AddUncompressSample(Statistics &stat, const Sample &start,
+                         const Sample &stop, size_t bytes) {
+  AddElapsedTime(stat.uncompressed_time, start.time, stop.time);
+  stat.uncompress_counts.Add(start.counts, stop.counts);
+  stat.uncompress_counts.bytes += bytes;
+}
+
+// The entries of a map in a vector, so they can be dealt out to threads
+template <typename Map>
+vector<typename Map::const_pointer> Entries(const Map &map) {
+  vector<typename Map::const_pointer> entries;
+  entries.reserve(map.size());
+  for (const auto &it : map)
+    entries.push_back(&it);
+  return entries;
+}
+
+// Run work(i, thread_stat) for every i in [0, n) on the given number of
+// threads. Items are dealt out round-robin, every thread counts into its own
+// Statistics, which are merged into stat at the end. The threads may only
+// read the maps of AllData and modify values of entries that already exist.
+template <typename Work>
+void ParallelFor(size_t n, size_t threads, Statistics &stat, Work work) {
+  struct timespec start, stop;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  threads = max<size_t>(min(threads, n), 1);
+  vector<Statistics> thread_stats(threads);
+  vector<timespec> busy_times(threads);
+  auto run = [&](size_t t) {
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    unique_ptr<PerfCounters> counters;
+    if (collect_perf_counters) {
+      counters.reset(new PerfCounters());
+      thread_perf_counters = counters.get();
+    }
+    for (size_t i = t; i < n; i += threads)
+      work(i, thread_stats[t]);
+    thread_perf_counters = nullptr;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    AddElapsedTime(busy_times[t], begin, end);
+  };
+  vector<thread> workers;
+  for (size_t t = 1; t < threads; ++t)
+    workers.emplace_back(run, t);
+  run(0);
+  for (thread &worker : workers)
+    worker.join();
+  for (const Statistics &thread_stat : thread_stats)
+    stat.Merge(thread_stat);
+  stat.AddWorkerBusyTimes(busy_times);
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  AddElapsedTime(stat.wall_time, start, stop);
+}
+
+// Like ParallelFor(), but every item is a task of a WorkStealingScheduler
+// queued on the worker of hint(i), so skewed items are spread over the
+// threads while the items of one hint mostly run on one thread.
+template <typename Hint, typename Work>
+void StealingFor(size_t n, size_t threads, Statistics &stat, Hint hint,
+                 Work work) {
+  struct timespec start, stop;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  threads = max<size_t>(min(threads, n), 1);
+  vector<Statistics> thread_stats(threads);
+  vector<unique_ptr<PerfCounters>> counters(threads);
+  WorkStealingScheduler scheduler(threads);
+  for (size_t i = 0; i < n; ++i)
+    scheduler.Submit(hint(i),
+                     [&, i](size_t worker) { work(i, thread_stats[worker]); });
+  scheduler.Run(
+      [&](size_t worker) {
+        if (collect_perf_counters) {
+          counters[worker].reset(new PerfCounters());
+          thread_perf_counters = counters[worker].get();
+        }
+      },
+      [&](size_t) { thread_perf_counters = nullptr; });
+  for (const Statistics &thread_stat : thread_stats)
+    stat.Merge(thread_stat);
+  vector<timespec> busy_times;
+  for (const WorkerLoad &load : scheduler.Loads()) {
+    busy_times.push_back(load.busy_time);
+    stat.steals += load.steals;
+  }
+  stat.AddWorkerBusyTimes(busy_times);
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  AddElapsedTime(stat.wall_time, start, stop);
+}
+
+// Run work(group, item, thread_stat) for every item of every group, with
+// sizes[group] items in each. The static scheduler runs whole groups with
+// ParallelFor(), the stealing one every item as a task hinted by its group.
+template <typename Work>
+void GroupsFor(const vector<size_t> &sizes, SchedulerType scheduler,
+               size_t threads, Statistics &stat, Work work) {
+  if (scheduler == kStaticScheduler) {
+    ParallelFor(sizes.size(), threads, stat, [&](size_t g, Statistics &stat) {
+      for (size_t k = 0; k < sizes[g]; ++k)
+        work(g, k, stat);
+    });
+    return;
+  }
+  vector<pair<size_t, size_t>> items;
+  for (size_t g = 0; g < sizes.size(); ++g) {
+    for (size_t k = 0; k < sizes[g]; ++k)
+      items.emplace_back(g, k);
+  }
+  StealingFor(
+      items.size(), threads, stat, [&](size_t i) { return items[i].first; },
+      [&](size_t i, Statistics &stat) {
+        work(items[i].first, items[i].second, stat);
+      });
+}
+
+void ScanSimilarRecords(AllData &data, PhaseRegistry &phases) {
+  cout << "scaning similar records in the feature index" << endl;
+  ScopedPhaseTimer timer(phases, "scan similar records");
   for (const auto &it : data.key_value) {
     const string &base_key = it.first;
+    timer.AddRecords(1, it.second.size());
     vector<string> similar_keys;
     data.table.GetSimilarRecordsKeys(base_key, similar_keys);
     if (!similar_keys.empty())
@@ -74,114 +184,1597 @@ void ScanSimilarRecords(AllData &data) {
   }
 }
 
-void CleanCompressedDeltas(AllData &data) { data.key_compressed_delta.clear(); }
+// Clear the deltas of the last method, then create an empty entry for every
+// similar record, so the compress threads only modify existing entries.
+void CleanCompressedDeltas(AllData &data, PhaseRegistry &phases) {
+  ScopedPhaseTimer timer(phases, "delta map insert");
+  data.key_compressed_delta.clear();
+  data.basekey_deltakeys.clear();
+  for (const auto &it : data.basekey_similarkeys) {
+    data.basekey_deltakeys[it.first];
+    for (const string &similar_key : it.second)
+      data.key_compressed_delta[similar_key];
+    timer.AddRecords(it.second.size(), 0);
+  }
+}
+
+// Compress every record alone. The result is the fallback of the records that
+// are not delta compressed.
+void StartSelfCompress(AllData &data, size_t threads, Statistics &stat) {
+  auto records = Entries(data.key_value);
+  for (auto record : records)
+    data.key_self_compressed_size[record->first] = 0;
+
+  ParallelFor(records.size(), threads, stat, [&](size_t i, Statistics &stat) {
+    const string &key = records[i]->first;
+    const string &value = records[i]->second;
+    string compressed, output;
+
+    Sample start, stop;
+    TakeSample(&start);
+    bool ok = LZCompress(value, &compressed);
+    TakeSample(&stop);
+    AddCompressSample(stat, start, stop, value.size());
+    if (!ok) {
+      stat.compress_fail++;
+      return;
+    }
+    stat.compress_success++;
+    stat.original_size.size_ += value.size();
+    stat.compressed_size.size_ += compressed.size();
+    data.key_self_compressed_size.at(key) = compressed.size();
+
+    TakeSample(&start);
+    ok = LZUncompress(compressed, &output);
+    TakeSample(&stop);
+    AddUncompressSample(stat, start, stop, value.size());
+    if (!ok || output != value)
+      ++stat.uncompress_fail;
+  });
+}
+
+void CountStorage(AllData &data, StorageStatistics &storage) {
+  unordered_set<string> delta_keys;
+  for (const auto &it : data.basekey_deltakeys) {
+    for (const string &delta_key : it.second) {
+      delta_keys.insert(delta_key);
+      storage.delta_size.size_ += data.key_compressed_delta[delta_key].size();
+    }
+  }
+  storage.delta_records = delta_keys.size();
+
+  for (const auto &it : data.key_value) {
+    const string &key = it.first;
+    storage.original_size.size_ += it.second.size();
+    if (delta_keys.count(key))
+      continue;
+    size_t self_compressed_size = data.key_self_compressed_size[key];
+    if (self_compressed_size) {
+      ++storage.self_records;
+      storage.self_size.size_ += self_compressed_size;
+    } else {
+      ++storage.raw_records;
+      storage.raw_size.size_ += it.second.size();
+    }
+  }
+}
 
+// Needs the entries created by CleanCompressedDeltas()
 void StartDeltaCompress(AllData &data, const DeltaCompressType type,
+                        size_t threads, SchedulerType scheduler,
                         Statistics &stat) {
-  for (auto &it : data.basekey_similarkeys) {
-    const string &base_key = it.first;
-    const vector<string> &similar_keys = it.second;
-    const string &base = data.key_value[base_key];
+  auto clusters = Entries(data.basekey_similarkeys);
+  vector<size_t> sizes;
+  // set by the thread of every pair, collected after the stage
+  vector<vector<char>> compressed;
+  for (auto cluster : clusters) {
+    sizes.push_back(cluster->second.size());
+    compressed.emplace_back(cluster->second.size());
+  }
+  GroupsFor(sizes, scheduler, threads, stat,
+            [&](size_t i, size_t k, Statistics &stat) {
+    const string &base = data.key_value.at(clusters[i]->first);
+    const string &similar_key = clusters[i]->second[k];
+    string delta;
+    const string &input = data.key_value.at(similar_key);
+
+    Sample start, stop;
+    TakeSample(&start);
+    assert(!input.empty() && !base.empty());
+    bool ok = DeltaCompress(type, input, base, &delta);
+    TakeSample(&stop);
+    AddCompressSample(stat, start, stop, input.size());
+    if (!ok) {
+      stat.compress_fail++;
+    } else {
+      stat.compress_success++;
+      stat.original_size.size_ += input.size();
+      stat.compressed_size.size_ += delta.size();
+      compressed[i][k] = true;
+      data.key_compressed_delta.at(similar_key) = move(delta);
+    }
+  });
 
+  for (size_t i = 0; i < clusters.size(); ++i) {
     vector<string> compress_success_keys;
-    for (const string &similar_key : similar_keys) {
-      string delta;
-      const string &input = data.key_value[similar_key];
+    for (size_t k = 0; k < sizes[i]; ++k) {
+      if (compressed[i][k])
+        compress_success_keys.push_back(clusters[i]->second[k]);
+    }
+    data.basekey_deltakeys.at(clusters[i]->first) =
+        move(compress_success_keys);
+  }
+}
 
-      struct timespec start, stop;
-      clock_gettime(CLOCK_MONOTONIC, &start);
-      assert(!input.empty() && !base.empty());
-      bool ok = DeltaCompress(type, input, base, &delta);
-      clock_gettime(CLOCK_MONOTONIC, &stop);
-      AddElapsedTime(stat.compressed_time, start, stop);
+void StartDeltaUncompress(AllData &data, const DeltaCompressType type,
+                          size_t threads, SchedulerType scheduler,
+                          Statistics &stat) {
+  auto clusters = Entries(data.basekey_deltakeys);
+  vector<size_t> sizes;
+  for (auto cluster : clusters)
+    sizes.push_back(cluster->second.size());
+  GroupsFor(sizes, scheduler, threads, stat,
+            [&](size_t i, size_t k, Statistics &stat) {
+    const string &base = data.key_value.at(clusters[i]->first);
+    string output;
+    const string &delta = data.key_compressed_delta.at(clusters[i]->second[k]);
+
+    Sample start, stop;
+    TakeSample(&start);
+    assert(!delta.empty() && !base.empty());
+    bool ok = DeltaUncompress(type, delta, base, &output);
+    TakeSample(&stop);
+    AddUncompressSample(stat, start, stop, output.size());
+
+    if (!ok) {
+      ++stat.uncompress_fail;
+    }
+  });
+}
+
+// Entropy code every delta that passed the ratio test as a whole, with one
+// order-0 Huffman table over its instructions and literals together. The
+// times are only the extra CPU spent by the second stage, the ratio is the
+// combined ratio of the original records to the entropy coded deltas.
+void StartEntropyCoding(AllData &data, size_t threads, Statistics &stat) {
+  auto clusters = Entries(data.basekey_deltakeys);
+  ParallelFor(clusters.size(), threads, stat, [&](size_t i, Statistics &stat) {
+    for (const string &delta_key : clusters[i]->second) {
+      const string &delta = data.key_compressed_delta.at(delta_key);
+      string coded, decoded;
+
+      Sample start, stop;
+      TakeSample(&start);
+      bool huffman = EntropyCompress(delta, &coded);
+      TakeSample(&stop);
+      AddCompressSample(stat, start, stop, delta.size());
+
+      TakeSample(&start);
+      bool ok = EntropyUncompress(coded, &decoded);
+      TakeSample(&stop);
+      AddUncompressSample(stat, start, stop, delta.size());
+
+      if (huffman)
+        stat.compress_success++;
+      else
+        stat.compress_fail++;
+      if (!ok || decoded != delta)
+        ++stat.uncompress_fail;
+      stat.original_size.size_ += data.key_value.at(delta_key).size();
+      stat.compressed_size.size_ += coded.size();
+    }
+  });
+}
+
+// Compress the members of every cluster in basekey_similarkeys against the
+// cluster dictionary. Building the dictionary counts as compress time, and the
+// dictionary bytes beyond the base count once per cluster as compressed size.
+void StartDictionaryCompress(AllData &data, const DeltaCompressType type,
+                             size_t threads, Statistics &stat) {
+  auto clusters = Entries(data.basekey_similarkeys);
+  ParallelFor(clusters.size(), threads, stat, [&](size_t i, Statistics &stat) {
+    const string &base = data.key_value.at(clusters[i]->first);
+    const vector<string> &similar_keys = clusters[i]->second;
+
+    Sample start, stop;
+    TakeSample(&start);
+    vector<const string *> members;
+    for (const string &similar_key : similar_keys)
+      members.push_back(&data.key_value.at(similar_key));
+    string dictionary;
+    BuildClusterDictionary(base, members, &dictionary);
+    TakeSample(&stop);
+    AddCompressSample(stat, start, stop, 0);
+
+    bool cluster_compressed = false;
+    for (const string *input : members) {
+      string delta, output;
+      TakeSample(&start);
+      bool ok = DeltaCompress(type, *input, dictionary, &delta);
+      TakeSample(&stop);
+      AddCompressSample(stat, start, stop, input->size());
+      if (!ok) {
+        stat.compress_fail++;
+        continue;
+      }
+      stat.compress_success++;
+      stat.original_size.size_ += input->size();
+      stat.compressed_size.size_ += delta.size();
+      cluster_compressed = true;
+
+      TakeSample(&start);
+      ok = DeltaUncompress(type, delta, dictionary, &output);
+      TakeSample(&stop);
+      AddUncompressSample(stat, start, stop, input->size());
+      if (!ok || output != *input)
+        ++stat.uncompress_fail;
+    }
+    if (cluster_compressed)
+      stat.compressed_size.size_ += dictionary.size() - base.size();
+  });
+}
+
+// The up to n members before member i sharing the most super features with
+// it, the earlier one first on a tie. Members sharing none are not similar.
+static vector<size_t>
+MostSimilarMembers(const vector<SuperFeatures> &super_features, size_t i,
+                   size_t n) {
+  vector<pair<size_t, size_t>> shared;
+  for (size_t j = 0; j < i; ++j) {
+    size_t count = 0;
+    for (super_feature_t sf : super_features[i])
+      count += count_if(super_features[j].begin(), super_features[j].end(),
+                        [sf](super_feature_t other) { return other == sf; });
+    if (count)
+      shared.emplace_back(count, j);
+  }
+  stable_sort(shared.begin(), shared.end(),
+              [](const pair<size_t, size_t> &a, const pair<size_t, size_t> &b) {
+                return a.first > b.first;
+              });
+  vector<size_t> members;
+  for (size_t k = 0; k < shared.size() && k < n; ++k)
+    members.push_back(shared[k].second);
+  return members;
+}
+
+// Every member of a cluster can COPY from the cluster base and from up to
+// max_bases - 1 other members, the ones sharing the most super features with
+// it. Only members listed before it are candidates, so the cluster decodes in
+// list order. The list is in the order of the similarity scan, not a revision
+// order. The super features are generated again, the scan removed them from
+// the index, and that time is not counted.
+void StartMultiBaseDeltaCompress(AllData &data, const DeltaCompressType type,
+                                 size_t max_bases, size_t threads,
+                                 Statistics &stat) {
+  auto clusters = Entries(data.basekey_similarkeys);
+  ParallelFor(clusters.size(), threads, stat, [&](size_t c, Statistics &stat) {
+    const string &base = data.key_value.at(clusters[c]->first);
+    const vector<string> &similar_keys = clusters[c]->second;
+    unique_ptr<SimilarityDetector> detector =
+        NewSimilarityDetector(data.table.Parameters());
+    vector<SuperFeatures> super_features;
+    for (const string &key : similar_keys)
+      super_features.push_back(
+          detector->GenerateSuperFeatures(data.key_value.at(key)));
+    for (size_t i = 0; i < similar_keys.size(); ++i) {
+      const string &input = data.key_value.at(similar_keys[i]);
+      vector<const string *> bases{&base};
+      for (size_t j : MostSimilarMembers(super_features, i, max_bases - 1))
+        bases.push_back(&data.key_value.at(similar_keys[j]));
+
+      string delta, output;
+      Sample start, stop;
+      TakeSample(&start);
+      bool ok = DeltaCompress(type, input, bases, &delta);
+      TakeSample(&stop);
+      AddCompressSample(stat, start, stop, input.size());
       if (!ok) {
         stat.compress_fail++;
-      } else {
+        continue;
+      }
+      stat.compress_success++;
+      stat.original_size.size_ += input.size();
+      stat.compressed_size.size_ += delta.size();
+
+      TakeSample(&start);
+      ok = DeltaUncompress(type, delta, bases, &output);
+      TakeSample(&stop);
+      AddUncompressSample(stat, start, stop, input.size());
+      if (!ok || output != input)
+        ++stat.uncompress_fail;
+    }
+  });
+}
+
+// Print a result row. The row runs as a phase of the data set named after
+// the method, see BenchmarkDataSet().
+void AddStatistics(const Statistics &stat, ResultWriter &writer,
+                   PhaseRegistry &phases, vector<ResultRow> &perf_rows) {
+  writer.Add(stat.ToRow());
+  PhaseStatistics &phase = phases.Phase(stat.method);
+  phase.records += stat.compress_success + stat.compress_fail;
+  phase.bytes += stat.compress_counts.bytes;
+  if (stat.uncompress_fail)
+    printf("!!!!!   Uncompress fail %zu times   !!!!!\n", stat.uncompress_fail);
+  if (collect_perf_counters) {
+    perf_rows.push_back(stat.compress_counts.ToRow(stat.method + " compress"));
+    perf_rows.push_back(
+        stat.uncompress_counts.ToRow(stat.method + " uncompress"));
+  }
+}
+
+// Detect similar records, then run every selected delta compression method
+// over them
+void BenchmarkDataSet(AllData &data, DataReader &data_reader,
+                      const BenchmarkOptions &options, ResultWriter &writer) {
+  const size_t threads = options.threads;
+  PhaseRegistry &phases = data_reader.phases_;
+  vector<ResultRow> perf_rows;
+  if (collect_perf_counters)
+    perf_rows.push_back(
+        data_reader.feature_counts_.ToRow("feature extraction"));
+  MemoryReport memory;
+  // ScanSimilarRecords empties the feature index, so it is measured first
+  const size_t records = data.key_value.size();
+  const size_t feature_key_bytes = data.table.FeatureKeyTableBytes();
+  const size_t key_feature_bytes = data.table.KeyFeatureTableBytes();
+  memory.Add("feature index", data.table.Size(),
+             feature_key_bytes + key_feature_bytes);
+  memory.Add("feature_key_table_", data.table.Size(), feature_key_bytes);
+  memory.Add("key_feature_table_", data.table.Size(), key_feature_bytes);
+  memory.Add("key_value", records, HeapBytes(data.key_value));
+
+  ScanSimilarRecords(data, phases);
+  memory.Add("basekey_similarkeys", data.basekey_similarkeys.size(),
+             HeapBytes(data.basekey_similarkeys));
+  cout << "start delta compress" << endl;
+  if (options.self_compression) {
+    Statistics self_stat;
+    self_stat.method = "lz (self)";
+    {
+      ScopedPhaseTimer timer(phases, self_stat.method);
+      StartSelfCompress(data, threads, self_stat);
+    }
+    memory.Add("key_self_compressed_size", data.key_self_compressed_size.size(),
+               HeapBytes(data.key_self_compressed_size));
+    AddStatistics(self_stat, writer, phases, perf_rows);
+  }
+
+  vector<StorageStatistics> storages;
+  for (DeltaCompressType type : options.codecs) {
+    Statistics stat;
+    stat.method = ToString(type);
+
+    if (type == kGdelta_init) {
+      ScopedPhaseTimer timer(phases, "gdelta_init matrix");
+      initematrix();
+    }
+    CleanCompressedDeltas(data, phases);
+    {
+      ScopedPhaseTimer timer(phases, stat.method);
+      StartDeltaCompress(data, type, threads, options.scheduler, stat);
+      StartDeltaUncompress(data, type, threads, options.scheduler, stat);
+    }
+    memory.Add("key_compressed_delta", data.key_compressed_delta.size(),
+               HeapBytes(data.key_compressed_delta));
+    memory.Add("basekey_deltakeys", data.basekey_deltakeys.size(),
+               HeapBytes(data.basekey_deltakeys));
+    AddStatistics(stat, writer, phases, perf_rows);
+
+    if (options.entropy_coding) {
+      Statistics entropy_stat;
+      entropy_stat.method = ToString(type) + "+whole-delta-huffman";
+      ScopedPhaseTimer timer(phases, entropy_stat.method);
+      StartEntropyCoding(data, threads, entropy_stat);
+      AddStatistics(entropy_stat, writer, phases, perf_rows);
+    }
+
+    if (options.cluster_dictionary) {
+      Statistics dictionary_stat;
+      dictionary_stat.method = ToString(type) + "+dict";
+      ScopedPhaseTimer timer(phases, dictionary_stat.method);
+      StartDictionaryCompress(data, type, threads, dictionary_stat);
+      AddStatistics(dictionary_stat, writer, phases, perf_rows);
+    }
+
+    if (options.multi_bases) {
+      Statistics multi_base_stat;
+      multi_base_stat.method =
+          ToString(type) + "+multi" + to_string(options.multi_bases);
+      ScopedPhaseTimer timer(phases, multi_base_stat.method);
+      StartMultiBaseDeltaCompress(data, type, options.multi_bases, threads,
+                                  multi_base_stat);
+      AddStatistics(multi_base_stat, writer, phases, perf_rows);
+    }
+
+    StorageStatistics storage;
+    storage.method = ToString(type) + (options.self_compression ? "+lz" : "");
+    {
+      ScopedPhaseTimer timer(phases, "count storage");
+      CountStorage(data, storage);
+      timer.AddRecords(data.key_value.size(), storage.original_size.size_);
+    }
+    storages.push_back(storage);
+  }
+
+  writer.EndTable();
+  cout << "\nstorage of all records"
+       << (options.self_compression ? ", falling back to lz compression" : "")
+       << endl;
+  for (StorageStatistics &storage : storages)
+    writer.Add(storage.ToRow());
+
+  if (collect_perf_counters) {
+    writer.EndTable();
+    cout << "\nhardware counters in user space, summed over threads" << endl;
+    for (const ResultRow &row : perf_rows)
+      writer.Add(row);
+  }
+
+  writer.EndTable();
+  cout << "\nestimated memory of the largest size of every structure, "
+          "current RSS "
+       << HumanReadable(CurrentResidentBytes()) << endl;
+  memory.AddRows(records, writer);
+
+  writer.EndTable();
+  cout << "\ntime of every phase, \"a/b\" is a part of \"a\"" << endl;
+  phases.AddRows(writer);
+}
+
+// Run the similarity detection with the parameters of result and the delta
+// compression method, and fill in the rest of result. The records are moved
+// into the AllData of the combination and back, not copied.
+void SweepConfig(AllData &data, const BenchmarkOptions &options,
+                 DeltaCompressType type, PhaseRegistry &phases,
+                 SweepResult &result) {
+  const FeatureParameters &parameters = result.parameters;
+  printf("sweep: %s, sample mask %s, %zu features, %zu super features, "
+         "max scan bytes %zu\n",
+         ToString(parameters.detector).c_str(),
+         SampleMaskName(parameters.sample_mask).c_str(),
+         parameters.feature_number, parameters.super_feature_number,
+         parameters.max_scan_bytes);
+  fflush(stdout);
+
+  AllData *config_data = new AllData(parameters, data.arena != nullptr);
+  config_data->key_value.swap(data.key_value);
+
+  const size_t records = config_data->key_value.size();
+  uintmax_t bytes = 0;
+  struct timespec start, stop, time{};
+  {
+    ScopedPhaseTimer timer(phases, "sweep feature index put");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (const auto &it : config_data->key_value) {
+      config_data->table.Put(it.first, it.second);
+      bytes += it.second.size();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    timer.AddRecords(records, bytes);
+  }
+  AddElapsedTime(time, start, stop);
+  result.feature_throughput = Throughput(bytes, time);
+  result.index_bytes_per_record =
+      (double)(config_data->table.FeatureKeyTableBytes() +
+               config_data->table.KeyFeatureTableBytes()) /
+      max<size_t>(records, 1);
+  result.candidate_records = config_data->table.CountAllSimilarRecords();
+
+  ScanSimilarRecords(*config_data, phases);
+  CleanCompressedDeltas(*config_data, phases);
+  Statistics stat;
+  {
+    ScopedPhaseTimer timer(phases, "sweep " + ToString(type));
+    StartDeltaCompress(*config_data, type, options.threads, options.scheduler,
+                       stat);
+    timer.AddRecords(stat.compress_success + stat.compress_fail,
+                     stat.compress_counts.bytes);
+  }
+  StorageStatistics storage;
+  CountStorage(*config_data, storage);
+  result.delta_ratio = (double)storage.original_size.size_ /
+                       (storage.delta_size.size_ + storage.self_size.size_ +
+                        storage.raw_size.size_);
+  for (const auto &it : config_data->basekey_deltakeys)
+    result.delta_keys.insert(result.delta_keys.end(), it.second.begin(),
+                             it.second.end());
+
+  data.key_value.swap(config_data->key_value);
+  delete config_data;
+}
+
+// Run SweepConfig() with every detector and combination of the sweep
+// parameters, then compare them.
+void SweepDataSet(AllData &data, DataReader &data_reader,
+                  const BenchmarkOptions &options, ResultWriter &writer) {
+  const DeltaCompressType type = options.codecs.front();
+  PhaseRegistry &phases = data_reader.phases_;
+  if (type == kGdelta_init)
+    initematrix();
+
+  vector<SweepResult> results;
+  SweepResult result;
+  FeatureParameters &parameters = result.parameters;
+  parameters = options.feature_parameters;
+  for (SimilarityDetectorType detector : options.sweep_detectors) {
+    parameters.detector = detector;
+    // the other detectors don't sample and scan whole values
+    const size_t masks =
+        detector == kOdess ? options.sweep_sample_masks.size() : 1;
+    const size_t max_scan_bytes =
+        detector == kOdess ? options.sweep_max_scan_bytes.size() : 1;
+    for (size_t m = 0; m < masks; ++m) {
+      parameters.sample_mask = options.sweep_sample_masks[m];
+      for (size_t feature_number : options.sweep_feature_numbers) {
+        parameters.feature_number = feature_number;
+        for (size_t super_feature_number :
+             options.sweep_super_feature_numbers) {
+          if (feature_number % super_feature_number != 0)
+            continue;
+          parameters.super_feature_number = super_feature_number;
+          for (size_t c = 0; c < max_scan_bytes; ++c) {
+            parameters.max_scan_bytes =
+                detector == kOdess ? options.sweep_max_scan_bytes[c] : 0;
+            results.push_back(result);
+            SweepConfig(data, options, type, phases, results.back());
+          }
+        }
+      }
+    }
+  }
+
+  EvaluateSweep(results);
+  writer.EndTable();
+  cout << "\nsweep of the similarity detection parameters with "
+       << ToString(type)
+       << ", recall is against the records delta compressed by any of them"
+       << endl;
+  for (const SweepResult &result : results)
+    writer.Add(result.ToRow());
+  writer.EndTable();
+  cout << "\nPareto frontier of delta ratio, feature MB/s and index "
+          "bytes/record"
+       << endl;
+  for (const SweepResult &result : results) {
+    if (!result.pareto)
+      continue;
+    ResultRow row = result.ToRow();
+    row.table = "pareto";
+    writer.Add(row);
+  }
+
+  writer.EndTable();
+  cout << "\ntime of every phase, \"a/b\" is a part of \"a\"" << endl;
+  phases.AddRows(writer);
+}
+
+// A delta is a good pair if it is at most 1/kOracleGoodDeltaRatio of the
+// record
+static const size_t kOracleGoodDeltaRatio = 2;
+
+// Delta compress options.oracle_samples sampled records against every other
+// record with the first selected method, and compare the best bases with the
+// candidates FeatureIndexTable returns. Needs the table before the scan.
+void OracleDataSet(AllData &data, DataReader &data_reader,
+                   const BenchmarkOptions &options, ResultWriter &writer) {
+  const DeltaCompressType type = options.codecs.front();
+  PhaseRegistry &phases = data_reader.phases_;
+  if (type == kGdelta_init)
+    initematrix();
+
+  vector<const string *> keys;
+  for (const auto &it : data.key_value)
+    keys.push_back(&it.first);
+  // the same samples in every run, whatever the hash order of key_value
+  sort(keys.begin(), keys.end(),
+       [](const string *a, const string *b) { return *a < *b; });
+  vector<const string *> samples(keys);
+  mt19937_64 random(0);
+  shuffle(samples.begin(), samples.end(), random);
+  samples.resize(min(options.oracle_samples, samples.size()));
+  cout << "oracle: delta compressing " << samples.size() << " records against "
+       << keys.size() << " records with " << ToString(type) << endl;
+
+  vector<OracleQuery> queries(samples.size());
+  Statistics stat;
+  {
+    ScopedPhaseTimer timer(phases, "oracle " + ToString(type));
+    ParallelFor(samples.size(), options.threads, stat,
+                [&](size_t i, Statistics &stat) {
+      const string &key = *samples[i];
+      const string &input = data.key_value.at(key);
+      vector<string> similar_keys;
+      data.table.FindSimilarRecordsKeys(key, similar_keys);
+      unordered_set<string> candidates(similar_keys.begin(),
+                                       similar_keys.end());
+
+      OracleQuery &query = queries[i];
+      query.size = input.size();
+      query.candidates = candidates.size();
+      query.oracle_size = query.detector_size = input.size();
+      for (const string *base_key : keys) {
+        if (*base_key == key)
+          continue;
+        const string &base = data.key_value.at(*base_key);
+        if (input.empty() || base.empty())
+          continue;
+        string delta;
+        Sample start, stop;
+        TakeSample(&start);
+        bool ok = DeltaCompress(type, input, base, &delta);
+        TakeSample(&stop);
+        AddCompressSample(stat, start, stop, input.size());
+        if (!ok) {
+          stat.compress_fail++;
+          continue;
+        }
         stat.compress_success++;
-        stat.original_size.size_ += input.size();
-        stat.compressed_size.size_ += delta.size();
-        compress_success_keys.push_back(move(similar_key));
+        bool candidate = candidates.count(*base_key) != 0;
+        query.oracle_size = min(query.oracle_size, delta.size());
+        if (candidate)
+          query.detector_size = min(query.detector_size, delta.size());
+        if (delta.size() * kOracleGoodDeltaRatio <= input.size()) {
+          query.good_pairs++;
+          query.good_candidates += candidate;
+        }
       }
-      data.key_compressed_delta[similar_key] = move(delta);
+    });
+    timer.AddRecords(stat.compress_success + stat.compress_fail,
+                     stat.compress_counts.bytes);
+  }
+
+  OracleStatistics oracle;
+  oracle.method = ToString(type);
+  for (const OracleQuery &query : queries)
+    oracle.Add(query);
+  writer.EndTable();
+  cout << "\nprecision and recall of the similarity detection, a good pair "
+          "delta compresses to at most 1/"
+       << kOracleGoodDeltaRatio << ", the ratios are of the sampled records"
+       << endl;
+  writer.Add(oracle.ToRow());
+
+  writer.EndTable();
+  cout << "\ntime of every phase, \"a/b\" is a part of \"a\"" << endl;
+  phases.AddRows(writer);
+}
+
+// Run the partitioned similarity detection with every number of processes of
+// --partitions, on the records of the in-process feature index.
+void PartitionDataSet(AllData &data, DataReader &data_reader,
+                      const BenchmarkOptions &options, ResultWriter &writer) {
+  PhaseRegistry &phases = data_reader.phases_;
+  vector<PartitionedIndexResult> results;
+  for (size_t partitions : options.partitions) {
+    printf("partitioned index: %zu processes\n", partitions);
+    // the children must not print the buffered output again
+    fflush(stdout);
+    PartitionedIndexResult result;
+    ScopedPhaseTimer timer(phases, "partitions " + to_string(partitions));
+    if (!RunPartitionedIndex(data.key_value, data.table.Parameters(),
+                             partitions, options.partition_directory,
+                             &result))
+      return;
+    timer.AddRecords(result.records, data_reader.put_key_value_size_.size_);
+    results.push_back(result);
+  }
+
+  for (PartitionedIndexResult &result : results)
+    result.speedup = TimespecToSeconds(results[0].wall_time) /
+                     TimespecToSeconds(result.wall_time);
+  writer.EndTable();
+  cout << "\npartitioned similarity detection, speedup is against "
+       << results[0].partitions << " processes, the in-process index has "
+       << data.table.CountAllSimilarRecords() << " candidates" << endl;
+  for (const PartitionedIndexResult &result : results)
+    writer.Add(result.ToRow());
+
+  writer.EndTable();
+  cout << "\ntime of every phase, \"a/b\" is a part of \"a\"" << endl;
+  phases.AddRows(writer);
+}
+
+// Stream the records in key order through index, delta compressing every
+// record that finds a base against it with type
+void RunBoundedIndex(AllData &data, const vector<const string *> &keys,
+                     const vector<SuperFeatures> &super_features,
+                     BoundedFeatureIndex &index,
+                     const BenchmarkOptions &options, DeltaCompressType type,
+                     BoundedIndexResult &result) {
+  vector<string> bases(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    ++result.lookups;
+    result.hits += index.FindBase(super_features[i], &bases[i]);
+    index.Insert(*keys[i], super_features[i]);
+    result.peak_bytes = max(result.peak_bytes, index.Bytes());
+  }
+  result.evictions = index.Evictions();
+
+  vector<size_t> stored(keys.size());
+  Statistics stat;
+  ParallelFor(keys.size(), options.threads, stat,
+              [&](size_t i, Statistics &stat) {
+    const string &input = data.key_value.at(*keys[i]);
+    stored[i] = input.size();
+    if (bases[i].empty() || input.empty())
+      return;
+    const string &base = data.key_value.at(bases[i]);
+    string delta;
+    Sample start, stop;
+    TakeSample(&start);
+    bool ok = DeltaCompress(type, input, base, &delta);
+    TakeSample(&stop);
+    AddCompressSample(stat, start, stop, input.size());
+    if (ok && delta.size() < input.size())
+      stored[i] = delta.size();
+  });
+  for (size_t i = 0; i < keys.size(); ++i) {
+    result.original_size += data.key_value.at(*keys[i]).size();
+    result.stored_size += stored[i];
+  }
+}
+
+// Compare the unbounded index with BoundedFeatureIndex at every budget and
+// eviction policy of the options, as an online dedup store would use it: the
+// records arrive in key order, look up a base among the resident records and
+// become bases themselves.
+void BoundedDataSet(AllData &data, DataReader &data_reader,
+                    const BenchmarkOptions &options, ResultWriter &writer) {
+  const DeltaCompressType type = options.codecs.front();
+  PhaseRegistry &phases = data_reader.phases_;
+  if (type == kGdelta_init)
+    initematrix();
+
+  vector<const string *> keys;
+  for (const auto &it : data.key_value)
+    keys.push_back(&it.first);
+  sort(keys.begin(), keys.end(),
+       [](const string *a, const string *b) { return *a < *b; });
+  vector<SuperFeatures> super_features(keys.size());
+  {
+    ScopedPhaseTimer timer(phases, "bounded index features");
+    unique_ptr<SimilarityDetector> detector =
+        NewSimilarityDetector(data.table.Parameters());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      const string &value = data.key_value.at(*keys[i]);
+      super_features[i] = detector->GenerateSuperFeatures(value);
+      timer.AddRecords(1, value.size());
+    }
+  }
+
+  BoundedIndexResult unbounded;
+  unbounded.policy = "-";
+  {
+    ScopedPhaseTimer timer(phases, "bounded index unbounded");
+    BoundedFeatureIndex index(kLruEviction, 0, 0);
+    RunBoundedIndex(data, keys, super_features, index, options, type,
+                    unbounded);
+    timer.AddRecords(keys.size(), unbounded.original_size);
+  }
+  unbounded.max_records = keys.size();
+  unbounded.max_bytes = unbounded.peak_bytes;
+  unbounded.unbounded_ratio = (double)unbounded.original_size /
+                              max<uintmax_t>(unbounded.stored_size, 1);
+  vector<BoundedIndexResult> results{unbounded};
+
+  for (EvictionPolicyType policy : options.eviction_policies) {
+    for (size_t percent : options.bounded_budgets) {
+      BoundedIndexResult result;
+      result.policy = ToString(policy);
+      result.budget_percent = percent;
+      if (options.budget_in_bytes)
+        result.max_bytes = max<size_t>(unbounded.max_bytes * percent / 100,
+                                       1);
+      else
+        result.max_records = max<size_t>(keys.size() * percent / 100, 1);
+      result.unbounded_ratio = unbounded.unbounded_ratio;
+      ScopedPhaseTimer timer(phases, "bounded index " + result.policy + " " +
+                                         to_string(percent) + "%");
+      BoundedFeatureIndex index(policy, result.max_records, result.max_bytes);
+      RunBoundedIndex(data, keys, super_features, index, options, type,
+                      result);
+      timer.AddRecords(keys.size(), result.original_size);
+      results.push_back(result);
     }
-    vector<string> &delta_keys = it.second;
-    delta_keys = move(compress_success_keys);
   }
+
+  writer.EndTable();
+  cout << "\nbounded feature index with " << ToString(type)
+       << ", budgets are percents of the "
+       << (options.budget_in_bytes ? "bytes" : "records")
+       << " of the unbounded index, a hit is a record finding a base" << endl;
+  for (const BoundedIndexResult &result : results)
+    writer.Add(result.ToRow());
+
+  writer.EndTable();
+  cout << "\ntime of every phase, \"a/b\" is a part of \"a\"" << endl;
+  phases.AddRows(writer);
 }
 
-void StartDeltaUncompress(AllData &data, const DeltaCompressType type,
-                          Statistics &stat) {
-  for (const auto &it : data.basekey_similarkeys) {
-    const string &base_key = it.first;
-    const vector<string> &delta_keys = it.second;
-    const string &base = data.key_value[base_key];
-    for (const string &delta_key : delta_keys) {
-      string output;
-      const string &delta = data.key_compressed_delta[delta_key];
+// The key of a delta compressed record and the key of its base
+typedef pair<const string *, const string *> DeltaRead;
+
+// Read every record of trace with type on the given number of threads,
+// fetching the bases through cache. Only the successful reads are timed in
+// result, the others are counted in result.failed.
+void ReplayReads(AllData &data, const vector<DeltaRead> &trace,
+                 DeltaCompressType type, size_t threads, BaseCache &cache,
+                 ReadReplayResult &result) {
+  // written by the thread of each read, summed after the run
+  vector<double> fetch_seconds(trace.size()), decode_seconds(trace.size());
+  vector<size_t> read_bytes(trace.size());
+  vector<double> latencies(trace.size());
+  vector<char> failed(trace.size());
+  Statistics stat;
+  ParallelFor(trace.size(), threads, stat, [&](size_t i, Statistics &) {
+    const string &delta = data.key_compressed_delta.at(*trace[i].first);
+    struct timespec start, fetched, decoded;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    shared_ptr<const string> base = cache.Get(*trace[i].second);
+    clock_gettime(CLOCK_MONOTONIC, &fetched);
+    string output;
+    bool ok = base && !delta.empty() &&
+              DeltaUncompress(type, delta, *base, &output);
+    clock_gettime(CLOCK_MONOTONIC, &decoded);
+
+    timespec fetch{}, decode{};
+    AddElapsedTime(fetch, start, fetched);
+    AddElapsedTime(decode, fetched, decoded);
+    fetch_seconds[i] = TimespecToSeconds(fetch);
+    decode_seconds[i] = TimespecToSeconds(decode);
+    latencies[i] = (fetch_seconds[i] + decode_seconds[i]) * 1e6;
+    read_bytes[i] = output.size();
+    failed[i] = !ok;
+  });
+  result.threads = max<size_t>(min(threads, trace.size()), 1);
+  result.wall_time = stat.wall_time;
+  // a failed read returns early in a store, its time would skew the others
+  for (size_t i = 0; i < trace.size(); ++i) {
+    if (failed[i]) {
+      ++result.failed;
+      continue;
+    }
+    ++result.reads;
+    result.latencies.push_back(latencies[i]);
+    result.read_bytes += read_bytes[i];
+    result.fetch_seconds += fetch_seconds[i];
+    result.decode_seconds += decode_seconds[i];
+  }
+  result.hits = cache.Hits();
+  result.misses = cache.Misses();
+  result.evictions = cache.Evictions();
+}
+
+// The reads of every distribution, or of the keys of the trace file, over
+// the records the last codec delta compressed. The records it stored as they
+// are have no base to fetch, so they are not read. The reads are drawn in
+// key order with the same seed for every codec.
+static vector<pair<string, vector<DeltaRead>>>
+DeltaReadTraces(const AllData &data, const vector<string> &trace_keys,
+                const BenchmarkOptions &options) {
+  vector<pair<string, vector<DeltaRead>>> traces;
+  vector<DeltaRead> reads;
+  for (const auto &it : data.basekey_deltakeys) {
+    for (const string &key : it.second)
+      reads.emplace_back(&key, &it.first);
+  }
+  if (!options.read_trace_path.empty()) {
+    unordered_map<string, DeltaRead> read_of;
+    for (const DeltaRead &read : reads)
+      read_of.emplace(*read.first, read);
+    traces.emplace_back("trace", vector<DeltaRead>());
+    for (const string &key : trace_keys) {
+      auto it = read_of.find(key);
+      if (it != read_of.end())
+        traces.back().second.push_back(it->second);
+    }
+    cout << "replaying " << traces.back().second.size() << " reads of "
+         << trace_keys.size() << " in " << options.read_trace_path
+         << ", the others are not delta compressed" << endl;
+    return traces;
+  }
+  if (reads.empty())
+    return traces;
+  // in write order, which also makes the traces the same in every run,
+  // whatever the hash order of basekey_deltakeys
+  sort(reads.begin(), reads.end(), [](const DeltaRead &a, const DeltaRead &b) {
+    return *a.first < *b.first;
+  });
+  for (ReadDistribution distribution : options.read_distributions) {
+    ReadKeyGenerator generator(distribution, reads.size(), options.zipf_theta,
+                               0);
+    traces.emplace_back(ToString(distribution), vector<DeltaRead>());
+    for (size_t i = 0; i < options.reads; ++i)
+      traces.back().second.push_back(reads[generator.Next()]);
+  }
+  cout << "replaying " << options.reads << " reads of " << reads.size()
+       << " delta compressed records with each distribution" << endl;
+  return traces;
+}
 
-      struct timespec start, stop;
+// Put the bases of the similar records into the selected BaseStore, then
+// delta compress them with every codec of the options and replay the reads of
+// DeltaReadTraces() with every base cache size. This is the decode path of a
+// store, which fetches the base before it decodes.
+void ReadReplayDataSet(AllData &data, DataReader &data_reader,
+                       const BenchmarkOptions &options, ResultWriter &writer) {
+  PhaseRegistry &phases = data_reader.phases_;
+  ScanSimilarRecords(data, phases);
+
+  unique_ptr<BaseStore> store =
+      NewBaseStore(options.base_store, options.base_store_directory);
+  if (!store)
+    return;
+  uintmax_t base_bytes = 0;
+  {
+    ScopedPhaseTimer timer(phases, "base store put");
+    for (const auto &it : data.basekey_similarkeys) {
+      const string &base = data.key_value.at(it.first);
+      if (!store->Put(it.first, base))
+        return;
+      base_bytes += base.size();
+      timer.AddRecords(1, base.size());
+    }
+  }
+  vector<string> trace_keys;
+  if (!options.read_trace_path.empty() &&
+      !ReadTraceFile(options.read_trace_path, &trace_keys))
+    return;
+
+  vector<ReadReplayResult> results;
+  for (DeltaCompressType type : options.codecs) {
+    if (type == kGdelta_init) {
+      ScopedPhaseTimer timer(phases, "gdelta_init matrix");
+      initematrix();
+    }
+    CleanCompressedDeltas(data, phases);
+    {
+      Statistics stat;
+      ScopedPhaseTimer timer(phases, ToString(type));
+      StartDeltaCompress(data, type, options.threads, options.scheduler,
+                         stat);
+    }
+    cout << ToString(type) << ": ";
+    const auto traces = DeltaReadTraces(data, trace_keys, options);
+    if (traces.empty() || traces[0].second.empty()) {
+      cout << "no delta compressed record to read" << endl;
+      continue;
+    }
+    for (const auto &trace : traces) {
+      for (size_t percent : options.base_cache_percents) {
+        ReadReplayResult result;
+        result.method = ToString(type);
+        result.store = ToString(options.base_store);
+        result.distribution = trace.first;
+        result.cache_percent = percent;
+        result.cache_bytes = base_bytes * percent / 100;
+        ScopedPhaseTimer timer(phases, "read replay " + result.method + " " +
+                                           trace.first + " " +
+                                           to_string(percent) + "%");
+        BaseCache cache(*store, result.cache_bytes);
+        ReplayReads(data, trace.second, type, options.threads, cache,
+                    result);
+        timer.AddRecords(result.reads, result.read_bytes);
+        results.push_back(move(result));
+      }
+    }
+  }
+
+  writer.EndTable();
+  cout << "\npoint reads fetching the base through an LRU cache, the cache "
+          "size is a percent of the "
+       << HumanReadable(base_bytes) << " of all bases" << endl;
+  for (ReadReplayResult &result : results)
+    writer.Add(result.ToRow());
+
+  writer.EndTable();
+  cout << "\ntime of every phase, \"a/b\" is a part of \"a\"" << endl;
+  phases.AddRows(writer);
+}
+
+// Microseconds from start to now
+static double MicrosecondsSince(const timespec &start) {
+  struct timespec stop, elapsed {};
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  AddElapsedTime(elapsed, start, stop);
+  return TimespecToSeconds(elapsed) * 1e6;
+}
+
+// One online run with type: options.writers threads insert the records in
+// key order, each insert followed by an update of a random written record
+// with probability options.update_ratio, while options.readers threads read
+// random written records until the writers are done.
+void RunOnline(AllData &data, const vector<const string *> &keys,
+               const BenchmarkOptions &options, DeltaCompressType type,
+               OnlineResult &result) {
+  const FeatureParameters &parameters = data.table.Parameters();
+  OnlineStore store(parameters, type);
+  atomic<size_t> next_insert(0);
+  unique_ptr<atomic<bool>[]> written(new atomic<bool>[keys.size()]);
+  for (size_t i = 0; i < keys.size(); ++i)
+    written[i] = false;
+  atomic<bool> writing(true);
+  vector<OnlineResult> writer_results(options.writers);
+  vector<OnlineResult> reader_results(options.readers);
+
+  auto write = [&](size_t w) {
+    unique_ptr<SimilarityDetector> detector = NewSimilarityDetector(parameters);
+    mt19937_64 random(w);
+    OnlineResult &own = writer_results[w];
+    size_t i;
+    while ((i = next_insert++) < keys.size()) {
+      struct timespec start;
       clock_gettime(CLOCK_MONOTONIC, &start);
-      assert(!delta.empty() && !base.empty());
-      bool ok = DeltaUncompress(type, delta, base, &output);
-      clock_gettime(CLOCK_MONOTONIC, &stop);
-      AddElapsedTime(stat.uncompressed_time, start, stop);
+      own.delta_records += store.Put(*detector, *keys[i],
+                                     data.key_value.at(*keys[i]),
+                                     &own.put_times);
+      own.write_latencies.push_back(MicrosecondsSince(start));
+      ++own.inserts;
+      written[i] = true;
 
-      const string &original = data.key_value[delta_key];
-      if (!ok) {
-        ++stat.uncompress_fail;
+      if (uniform_real_distribution<double>(0, 1)(random) >=
+          options.update_ratio)
+        continue;
+      size_t j = uniform_int_distribution<size_t>(0, i)(random);
+      if (!written[j])
+        continue;
+      // overwrite a few bytes, like an update of some fields
+      string value = data.key_value.at(*keys[j]);
+      if (!value.empty()) {
+        size_t at = uniform_int_distribution<size_t>(0, value.size() - 1)(
+            random);
+        for (size_t k = at; k < min(at + 8, value.size()); ++k)
+          value[k] = (char)random();
       }
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      own.delta_records +=
+          store.Put(*detector, *keys[j], value, &own.put_times);
+      own.write_latencies.push_back(MicrosecondsSince(start));
+      ++own.updates;
     }
+  };
+  auto read = [&](size_t r) {
+    mt19937_64 random(options.writers + r);
+    OnlineResult &own = reader_results[r];
+    string value;
+    while (writing) {
+      size_t inserted = min<size_t>(next_insert, keys.size());
+      if (inserted == 0)
+        continue;
+      size_t i = uniform_int_distribution<size_t>(0, inserted - 1)(random);
+      if (!written[i])
+        continue;
+      struct timespec start;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      bool ok = store.Get(*keys[i], &value);
+      own.read_latencies.push_back(MicrosecondsSince(start));
+      ++own.reads;
+      own.read_fails += !ok;
+    }
+  };
+
+  struct timespec start, stop;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  vector<thread> readers, writers;
+  for (size_t r = 0; r < options.readers; ++r)
+    readers.emplace_back(read, r);
+  for (size_t w = 0; w < options.writers; ++w)
+    writers.emplace_back(write, w);
+  for (thread &writer : writers)
+    writer.join();
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  writing = false;
+  for (thread &reader : readers)
+    reader.join();
+
+  AddElapsedTime(result.wall_time, start, stop);
+  result.writers = options.writers;
+  result.readers = options.readers;
+  for (const OnlineResult &own : writer_results)
+    result.Merge(own);
+  for (const OnlineResult &own : reader_results)
+    result.Merge(own);
+  for (const string *key : keys)
+    result.original_size += data.key_value.at(*key).size();
+  result.stored_size = store.StoredBytes(&result.pinned_size);
+}
+
+// Run every codec of the options in an OnlineStore, where the records are
+// ingested, matched, delta compressed and read at the same time instead of
+// in separate phases
+void OnlineDataSet(AllData &data, DataReader &data_reader,
+                   const BenchmarkOptions &options, ResultWriter &writer) {
+  PhaseRegistry &phases = data_reader.phases_;
+  vector<const string *> keys;
+  for (const auto &it : data.key_value)
+    keys.push_back(&it.first);
+  sort(keys.begin(), keys.end(),
+       [](const string *a, const string *b) { return *a < *b; });
+
+  vector<OnlineResult> results;
+  for (DeltaCompressType type : options.codecs) {
+    if (type == kGdelta_init) {
+      ScopedPhaseTimer timer(phases, "gdelta_init matrix");
+      initematrix();
+    }
+    OnlineResult result;
+    result.method = ToString(type);
+    cout << "online: " << options.writers << " writers and " << options.readers
+         << " readers with " << result.method << endl;
+    ScopedPhaseTimer timer(phases, "online " + result.method);
+    RunOnline(data, keys, options, type, result);
+    timer.AddRecords(result.inserts + result.updates, result.original_size);
+    results.push_back(move(result));
   }
+
+  writer.EndTable();
+  cout << "\nonline ingest and reads, the ratio is of the current version of "
+          "every record and the old bases its deltas pin, the times are "
+          "summed over the writers"
+       << endl;
+  for (OnlineResult &result : results)
+    writer.Add(result.ToRow());
+
+  writer.EndTable();
+  cout << "\ntime of every phase, \"a/b\" is a part of \"a\"" << endl;
+  phases.AddRows(writer);
 }
 
-void TestDataSet(DataSetType dataset) {
-  DataReader data_reader;
-  AllData *new_data = new AllData();
-  AllData &data = *new_data;
+// A base group copied by the worker that compresses it, so its memory is
+// placed by the memory policy of that worker
+struct NumaGroup {
+  string base;
+  vector<string> similar;
+  vector<string> deltas;
+  vector<char> compressed;
+};
+
+// Run work(worker) on threads threads, worker w on node w % nodes.size()
+// with kLocalPlacement. Returns the workers whose CPUs and memory policy
+// were set.
+template <typename Work>
+size_t RunNumaWorkers(const vector<NumaNode> &nodes, NumaPlacement placement,
+                      size_t threads, Work work) {
+  atomic<size_t> placed(0);
+  auto run = [&](size_t w) {
+    const NumaNode &node = nodes[w % nodes.size()];
+    bool ok = placement == kLocalPlacement
+                  ? PinThread(node) && BindThreadMemory(node)
+                  : InterleaveThreadMemory(nodes);
+    placed += ok;
+    work(w);
+  };
+  vector<thread> workers;
+  for (size_t w = 0; w < threads; ++w)
+    workers.emplace_back(run, w);
+  for (thread &worker : workers)
+    worker.join();
+  return placed;
+}
+
+// Delta compress and uncompress every base group with type, the groups and
+// their memory placed on the nodes by placement
+void RunNumaPlacement(AllData &data, const vector<NumaNode> &nodes,
+                      NumaPlacement placement, DeltaCompressType type,
+                      size_t threads, PhaseRegistry &phases, Statistics &stat) {
+  auto clusters = Entries(data.basekey_similarkeys);
+  // The local placement partitions the groups over the nodes by bytes, the
+  // largest first, the interleaved one has one queue for all workers
+  const size_t queue_number =
+      placement == kLocalPlacement ? nodes.size() : 1;
+  threads = max(threads, queue_number);
+  vector<vector<size_t>> queues(queue_number);
+  {
+    vector<pair<uintmax_t, size_t>> sizes;
+    for (size_t i = 0; i < clusters.size(); ++i) {
+      uintmax_t size = data.key_value.at(clusters[i]->first).size();
+      for (const string &key : clusters[i]->second)
+        size += data.key_value.at(key).size();
+      sizes.emplace_back(size, i);
+    }
+    sort(sizes.rbegin(), sizes.rend());
+    vector<uintmax_t> queue_bytes(queue_number);
+    for (const auto &size : sizes) {
+      size_t q = min_element(queue_bytes.begin(), queue_bytes.end()) -
+                 queue_bytes.begin();
+      queue_bytes[q] += size.first;
+      queues[q].push_back(size.second);
+    }
+  }
+  unique_ptr<atomic<size_t>[]> next(new atomic<size_t>[queue_number]);
+  auto reset = [&]() {
+    for (size_t q = 0; q < queue_number; ++q)
+      next[q] = 0;
+  };
+
+  vector<NumaGroup> groups(clusters.size());
+  size_t placed;
+  {
+    ScopedPhaseTimer timer(phases, stat.method + "/place");
+    reset();
+    placed = RunNumaWorkers(nodes, placement, threads, [&](size_t w) {
+      const vector<size_t> &queue = queues[w % queue_number];
+      size_t j;
+      while ((j = next[w % queue_number]++) < queue.size()) {
+        NumaGroup &group = groups[queue[j]];
+        const auto &cluster = *clusters[queue[j]];
+        group.base = data.key_value.at(cluster.first);
+        for (const string &key : cluster.second)
+          group.similar.push_back(data.key_value.at(key));
+        group.deltas.resize(group.similar.size());
+        group.compressed.resize(group.similar.size());
+      }
+    });
+    timer.AddRecords(clusters.size(), 0);
+  }
+  if (placed < threads)
+    cout << threads - placed << " of " << threads
+         << " workers can't be placed " << ToString(placement)
+         << ", they run on any CPU and memory" << endl;
+
+  struct timespec start, stop;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  vector<Statistics> thread_stats(threads);
+  vector<timespec> busy_times(threads);
+  reset();
+  RunNumaWorkers(nodes, placement, threads, [&](size_t w) {
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    Statistics &stat = thread_stats[w];
+    const vector<size_t> &queue = queues[w % queue_number];
+    size_t j;
+    while ((j = next[w % queue_number]++) < queue.size()) {
+      NumaGroup &group = groups[queue[j]];
+      for (size_t k = 0; k < group.similar.size(); ++k) {
+        const string &input = group.similar[k];
+        Sample sample_start, sample_stop;
+        TakeSample(&sample_start);
+        bool ok = DeltaCompress(type, input, group.base, &group.deltas[k]);
+        TakeSample(&sample_stop);
+        AddCompressSample(stat, sample_start, sample_stop, input.size());
+        group.compressed[k] = ok;
+        if (!ok) {
+          stat.compress_fail++;
+          continue;
+        }
+        stat.compress_success++;
+        stat.original_size.size_ += input.size();
+        stat.compressed_size.size_ += group.deltas[k].size();
+      }
+      for (size_t k = 0; k < group.similar.size(); ++k) {
+        if (!group.compressed[k])
+          continue;
+        string output;
+        Sample sample_start, sample_stop;
+        TakeSample(&sample_start);
+        bool ok = DeltaUncompress(type, group.deltas[k], group.base, &output);
+        TakeSample(&sample_stop);
+        AddUncompressSample(stat, sample_start, sample_stop, output.size());
+        stat.uncompress_fail += !ok;
+      }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    AddElapsedTime(busy_times[w], begin, end);
+  });
+  for (const Statistics &thread_stat : thread_stats)
+    stat.Merge(thread_stat);
+  stat.AddWorkerBusyTimes(busy_times);
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  AddElapsedTime(stat.wall_time, start, stop);
+}
+
+// Compare the local and interleaved NumaPlacement of the base groups with
+// every codec of the options
+void NumaDataSet(AllData &data, DataReader &data_reader,
+                 const BenchmarkOptions &options, ResultWriter &writer) {
+  PhaseRegistry &phases = data_reader.phases_;
+  const vector<NumaNode> nodes = NumaNodes();
+  cout << "numa: " << nodes.size() << " nodes";
+  for (const NumaNode &node : nodes)
+    cout << ", node " << node.id << " has " << node.cpus.size() << " CPUs";
+  cout << endl;
+  ScanSimilarRecords(data, phases);
+
+  vector<Statistics> stats;
+  for (DeltaCompressType type : options.codecs) {
+    if (type == kGdelta_init) {
+      ScopedPhaseTimer timer(phases, "gdelta_init matrix");
+      initematrix();
+    }
+    for (NumaPlacement placement : options.numa_placements) {
+      Statistics stat;
+      stat.method = ToString(type) + "@" + ToString(placement);
+      ScopedPhaseTimer timer(phases, stat.method);
+      RunNumaPlacement(data, nodes, placement, type, options.threads, phases,
+                       stat);
+      timer.AddRecords(stat.compress_success + stat.compress_fail,
+                       stat.compress_counts.bytes);
+      stats.push_back(stat);
+    }
+  }
+
+  writer.EndTable();
+  cout << "\ndelta compress and uncompress with the base groups placed on "
+          "the NUMA nodes, method@placement"
+       << endl;
+  for (const Statistics &stat : stats)
+    writer.Add(stat.ToRow());
+
+  writer.EndTable();
+  cout << "\ntime of every phase, \"a/b\" is a part of \"a\"" << endl;
+  phases.AddRows(writer);
+}
+
+AllData *NewAllData(const BenchmarkOptions &options) {
+  return new AllData(options.feature_parameters, options.arena);
+}
+
+// Delete data and add the time it takes as table "teardown". With an arena
+// this is the freeing of the key, value and delta strings, which are not in
+// the arena, and the unmapping of its blocks.
+void DeleteAllData(AllData *data, ResultWriter &writer) {
+  ResultRow row("teardown");
+  row.AddText("allocator", data->arena ? "arena" : "new");
+  row.AddCount("records", data->key_value.size());
+  row.AddSize("arena bytes", data->arena ? data->arena->AllocatedBytes() : 0);
+  row.AddCount("arena blocks", data->arena ? data->arena->Blocks() : 0);
+  struct timespec start, stop, time{};
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  delete data;
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  AddElapsedTime(time, start, stop);
+  row.AddSeconds("time", time);
+  writer.Add(row);
+  writer.EndTable();
+}
+
+// Replace the feature index with the snapshot at path. The records the
+// snapshot misses are indexed, the keys that are not loaded are dropped.
+bool LoadFeatureIndex(AllData &data, const string &path,
+                      const FeatureParameters &parameters,
+                      PhaseRegistry &phases) {
+  ScopedPhaseTimer timer(phases, "load feature index");
+  if (!data.table.Load(path))
+    return false;
+  if (data.table.Parameters() != parameters)
+    cout << "the feature parameters of " << path
+         << " are used instead of the selected ones" << endl;
+
+  size_t stale = 0, missing = 0;
+  for (const string &key : data.table.Keys()) {
+    if (data.key_value.count(key) == 0) {
+      data.table.Delete(key);
+      ++stale;
+    }
+  }
+  for (const auto &it : data.key_value) {
+    if (!data.table.Contains(it.first)) {
+      data.table.Put(it.first, it.second);
+      ++missing;
+      timer.AddRecords(0, it.second.size());
+    }
+  }
+  timer.AddRecords(data.key_value.size(), 0);
+  cout << "loaded the features of " << data.table.Size() - missing
+       << " records from " << path << ", indexed " << missing
+       << " new records, dropped " << stale << " missing records" << endl;
+  return true;
+}
+
+// Load or save the feature index if asked, then run the selected mode
+void RunDataSet(AllData &data, DataReader &data_reader,
+                const BenchmarkOptions &options, ResultWriter &writer) {
+  if (!options.load_index_path.empty() &&
+      !LoadFeatureIndex(data, options.load_index_path,
+                        options.feature_parameters, data_reader.phases_))
+    return;
+  if (!options.save_index_path.empty()) {
+    ScopedPhaseTimer timer(data_reader.phases_, "save feature index");
+    if (!data.table.Save(options.save_index_path))
+      return;
+    timer.AddRecords(data.table.Size(), 0);
+  }
+
+  if (options.sweep)
+    SweepDataSet(data, data_reader, options, writer);
+  else if (options.oracle)
+    OracleDataSet(data, data_reader, options, writer);
+  else if (!options.partitions.empty())
+    PartitionDataSet(data, data_reader, options, writer);
+  else if (options.bounded_index)
+    BoundedDataSet(data, data_reader, options, writer);
+  else if (options.read_replay)
+    ReadReplayDataSet(data, data_reader, options, writer);
+  else if (options.online)
+    OnlineDataSet(data, data_reader, options, writer);
+  else if (!options.numa_placements.empty())
+    NumaDataSet(data, data_reader, options, writer);
+  else
+    BenchmarkDataSet(data, data_reader, options, writer);
+}
+
+bool LoadDataSet(DataSetType dataset, DataReader &data_reader,
+                 AllData &data) {
+  bool ok = false;
   switch (dataset) {
   case kWikipedia: {
-    data_reader.PutWikipediaData(data);
+    ok = data_reader.PutWikipediaData(data);
     break;
   }
   case kEnronMail: {
-    data_reader.PutEnronMailData(data);
+    ok = data_reader.PutEnronMailData(data);
     break;
   }
   case kStackOverFlow:{
-    data_reader.PutStackOverFlowData(data);
+    ok = data_reader.PutStackOverFlowData(data);
     break;
   }
   case kStackOverFlowComment:{
-    data_reader.PutStackOverFlowCommentData(data);
+    ok = data_reader.PutStackOverFlowCommentData(data);
+    break;
+  }
+  case kSynthetic: {
+    ok = data_reader.PutSyntheticData(data);
     break;
   }
   default: {
     cerr << "dataset type not support" << endl;
+  }
+  }
+  return ok;
+}
+
+void TestDataSet(DataSetType dataset, const BenchmarkOptions &options,
+                 ResultWriter &writer) {
+  DataReader data_reader(options.percentage, options.synthetic);
+  if (collect_perf_counters)
+    data_reader.EnablePerfCounters();
+  if (!options.load_index_path.empty())
+    data_reader.DisableFeatureIndex();
+  AllData *new_data = NewAllData(options);
+  AllData &data = *new_data;
+  bool ok;
+  {
+    ScopedPhaseTimer timer(data_reader.load_phase_);
+    ok = LoadDataSet(dataset, data_reader, data);
+    timer.AddRecords(data_reader.total_records_,
+                     data_reader.put_key_value_size_.size_);
+  }
+  if (ok) {
+    writer.BeginDataSet(ToString(dataset));
+    RunDataSet(data, data_reader, options, writer);
+    DeleteAllData(new_data, writer);
+  } else {
+    delete new_data;
+  }
+}
+
+void TestAdapterDataSet(const string &spec, const BenchmarkOptions &options,
+                        ResultWriter &writer) {
+  unique_ptr<DatasetAdapter> adapter = NewDatasetAdapter(spec);
+  if (!adapter) {
+    cerr << "unknown data set spec: " << spec << endl;
     return;
   }
+  DataReader data_reader(options.percentage);
+  if (collect_perf_counters)
+    data_reader.EnablePerfCounters();
+  if (!options.load_index_path.empty())
+    data_reader.DisableFeatureIndex();
+  AllData *new_data = NewAllData(options);
+  bool ok;
+  {
+    ScopedPhaseTimer timer(data_reader.load_phase_);
+    ok = data_reader.PutAdapterData(*adapter, *new_data);
+    timer.AddRecords(data_reader.total_records_,
+                     data_reader.put_key_value_size_.size_);
   }
+  if (ok) {
+    writer.BeginDataSet(spec);
+    RunDataSet(*new_data, data_reader, options, writer);
+    DeleteAllData(new_data, writer);
+  } else {
+    delete new_data;
+  }
+}
 
-  ScanSimilarRecords(data);
-  cout << "start delta compress" << endl;
-  Statistics::PrintHead();
-  for (uint8_t i = kXDelta; i < kNumberOfDeltaCompression; ++i) {
-    DeltaCompressType type = (DeltaCompressType)i;
-    Statistics stat;
-    stat.type = type;
+// Round trip a synthetic record and its base of each size, around one xdelta
+// stream window and over three, through the stream API of every codec,
+// pushing in 4KB chunks and all at once. The stream delta must decode with
+// DeltaUncompress(), the delta of DeltaCompress() must decode through
+// DeltaUncompressStream, and both must compress under the same conditions.
+// Every round trip is a row of table "stream check". Returns false if any of
+// them fails.
+bool CheckDeltaStreams(const BenchmarkOptions &options, ResultWriter &writer) {
+  const size_t kWindow = DeltaCompressStream::kStreamWindowSize;
+  const size_t kChunkSize = 4 << 10;
+  bool all_ok = true;
+  writer.BeginDataSet("stream check");
+  for (size_t size : {4 * kChunkSize, kWindow - 1, kWindow, kWindow + 1,
+                      3 * kWindow + kChunkSize + 1}) {
+    SyntheticDataOptions synthetic;
+    synthetic.record_number = 2;
+    synthetic.size_distribution = kFixedSize;
+    synthetic.min_record_size = synthetic.max_record_size = size;
+    synthetic.cluster_size = 2;
+    // replaced bytes only, so every codec compresses the record, whatever
+    // its match finder
+    synthetic.insert_weight = synthetic.delete_weight = 0;
+    synthetic.shift_weight = 0;
+    SyntheticDataGenerator generator(synthetic);
+    string key, base, input;
+    generator.Next(&key, &base);
+    generator.Next(&key, &input);
 
-    if (type == kGdelta_init)
-      initematrix();
-    CleanCompressedDeltas(data);
-    StartDeltaCompress(data, type, stat);
-    StartDeltaUncompress(data, type, stat);
+    for (DeltaCompressType type : options.codecs) {
+      string delta;
+      const bool compressed = DeltaCompress(type, input, base, &delta);
+      for (size_t chunk_size : {kChunkSize, input.size()}) {
+        string stream_delta, output, stream_output;
+        DeltaCompressStream compress(type, base, input.size());
+        const bool stream_compressed =
+            RunStream(compress, input, chunk_size, &stream_delta);
+        string result = compressed ? "ok" : "not compressed";
+        if (stream_compressed != compressed) {
+          result = "compress mismatch";
+        } else if (stream_compressed &&
+                   (!DeltaUncompress(type, stream_delta, base, &output) ||
+                    output != input)) {
+          result = "stream delta doesn't decode";
+        } else if (compressed) {
+          DeltaUncompressStream uncompress(type, base);
+          if (!RunStream(uncompress, delta, chunk_size, &stream_output) ||
+              stream_output != input)
+            result = "delta doesn't stream decode";
+        }
+        all_ok &= result == "ok" || result == "not compressed";
 
-    stat.Print();
+        ResultRow row("stream check");
+        row.AddText("method", ToString(type));
+        // exact, the sizes around a window differ by a byte
+        row.AddCount("input bytes", input.size());
+        row.AddCount("chunk bytes", chunk_size);
+        row.AddCount("delta bytes", compressed ? delta.size() : 0);
+        row.AddCount("stream delta bytes",
+                     stream_compressed ? stream_delta.size() : 0);
+        row.AddText("result", result);
+        writer.Add(row);
+      }
+    }
   }
-  delete new_data;
+  return all_ok;
 }
 
-int main() {
-  for (uint8_t dataset = kWikipedia; dataset < kNumberOfDataSet; ++dataset)
-    TestDataSet((DataSetType)dataset);
-  return 0;
-}
\ No newline at end of file
+// See PrintUsage() for the options. Without options, run all built-in data
+// sets with all delta compression methods.
+int main(int argc, char *argv[]) {
+  BenchmarkOptions options;
+  bool exit = false;
+  if (!ParseBenchmarkOptions(argc, argv, &options, &exit)) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+  if (exit)
+    return 0;
+
+  if (options.perf_counters) {
+    collect_perf_counters = PerfCounters().Available();
+    if (!collect_perf_counters)
+      cerr << "hardware performance counters are not available, see "
+              "/proc/sys/kernel/perf_event_paranoid"
+           << endl;
+  }
+
+  ResultWriter writer(options.format, options.output_path);
+  if (options.stream_check) {
+    bool ok = CheckDeltaStreams(options, writer);
+    return writer.Finish() && ok ? 0 : 1;
+  }
+  for (DataSetType dataset : options.datasets)
+    TestDataSet(dataset, options, writer);
+  for (const string &spec : options.adapter_specs)
+    TestAdapterDataSet(spec, options, writer);
+  return writer.Finish() ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+#include "memory_usage.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+// Read a "Name:   1234 kB" line of /proc/self/status
+static size_t ReadStatusBytes(const char *name) {
+  FILE *fin = fopen("/proc/self/status", "r");
+  if (!fin)
+    return 0;
+  char line[256];
+  size_t kb = 0;
+  const size_t length = strlen(name);
+  while (fgets(line, sizeof(line), fin)) {
+    if (strncmp(line, name, length) == 0 && line[length] == ':') {
+      sscanf(line + length + 1, "%zu", &kb);
+      break;
+    }
+  }
+  fclose(fin);
+  return kb * 1024;
+}
+
+size_t CurrentResidentBytes() { return ReadStatusBytes("VmRSS"); }
+
+size_t PeakResidentBytes() { return ReadStatusBytes("VmHWM"); }
+
+bool ResetPeakResidentBytes() {
+  ofstream fout("/proc/self/clear_refs");
+  return fout && (fout << "5").flush();
+}
+
+// A short string is stored inside the string object itself
+size_t HeapBytes(const string &s) {
+  const char *self = reinterpret_cast<const char *>(&s);
+  if (s.data() >= self && s.data() < self + sizeof(s))
+    return 0;
+  return AllocationBytes(s.capacity() + 1);
+}
+
+ResultRow StructureMemory::ToRow(size_t records) const {
+  ResultRow row("memory");
+  row.AddText("structure", name);
+  row.AddCount("entries", entries);
+  row.AddSize("estimated bytes", bytes);
+  row.AddNumber("bytes/record", records ? (double)bytes / records : 0, 1);
+  return row;
+}
+
+void MemoryReport::Add(const string &name, size_t entries, size_t bytes) {
+  for (StructureMemory &structure : structures_) {
+    if (structure.name == name) {
+      structure.entries = max(structure.entries, entries);
+      structure.bytes = max(structure.bytes, bytes);
+      return;
+    }
+  }
+  structures_.emplace_back();
+  structures_.back().name = name;
+  structures_.back().entries = entries;
+  structures_.back().bytes = bytes;
+}
+
+void MemoryReport::AddRows(size_t records, ResultWriter &writer) const {
+  for (const StructureMemory &structure : structures_)
+    writer.Add(structure.ToRow(records));
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include "statistics.h"
+#include <cstddef>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Resident set size of the process from /proc/self/status, 0 if unknown
+size_t CurrentResidentBytes();
+// VmHWM, the peak resident set size since start or the last reset
+size_t PeakResidentBytes();
+// Reset VmHWM to the current RSS through /proc/self/clear_refs (Linux 4.0+).
+// Returns false if it can't, then the peak is the peak since start.
+bool ResetPeakResidentBytes();
+
+// Size estimators of the containers of the benchmark, counting the heap
+// memory the container owns. They follow the node layout of libstdc++ and
+// glibc malloc: every allocation has 8 bytes of header and is rounded up to
+// 16 bytes, minimum 32.
+inline size_t AllocationBytes(size_t size) {
+  size_t bytes = (size + 8 + 15) & ~(size_t)15;
+  return bytes < 32 ? 32 : bytes;
+}
+
+// Declare every overload before the templates use them
+inline size_t HeapBytes(unsigned long long) { return 0; }
+inline size_t HeapBytes(unsigned long) { return 0; }
+size_t HeapBytes(const string &s);
+template <typename T> size_t HeapBytes(const vector<T> &v);
+template <typename K, typename V> size_t HeapBytes(const pair<const K, V> &p);
+template <typename T, typename H, typename E, typename A>
+size_t HeapBytes(const unordered_set<T, H, E, A> &s);
+template <typename K, typename V, typename H, typename E, typename A>
+size_t HeapBytes(const unordered_map<K, V, H, E, A> &m);
+template <typename K, typename V, typename C, typename A>
+size_t HeapBytes(const map<K, V, C, A> &m);
+
+template <typename T> size_t HeapBytes(const vector<T> &v) {
+  size_t bytes = v.capacity() ? AllocationBytes(v.capacity() * sizeof(T)) : 0;
+  for (const T &element : v)
+    bytes += HeapBytes(element);
+  return bytes;
+}
+
+template <typename K, typename V> size_t HeapBytes(const pair<const K, V> &p) {
+  return HeapBytes(p.first) + HeapBytes(p.second);
+}
+
+// A hash table node is the next pointer, the value and, for keys that are
+// not integers, the cached hash. Plus one pointer per bucket.
+template <typename Table> size_t HashTableBytes(const Table &table) {
+  typedef typename Table::key_type Key;
+  const size_t node = sizeof(void *) + sizeof(typename Table::value_type) +
+                      (is_integral<Key>::value ? 0 : sizeof(size_t));
+  size_t bytes = table.bucket_count() > 1
+                     ? AllocationBytes(table.bucket_count() * sizeof(void *))
+                     : 0;
+  for (const auto &value : table)
+    bytes += AllocationBytes(node) + HeapBytes(value);
+  return bytes;
+}
+
+template <typename T, typename H, typename E, typename A>
+size_t HeapBytes(const unordered_set<T, H, E, A> &s) {
+  return HashTableBytes(s);
+}
+
+template <typename K, typename V, typename H, typename E, typename A>
+size_t HeapBytes(const unordered_map<K, V, H, E, A> &m) {
+  return HashTableBytes(m);
+}
+
+// A red-black tree node is the color and three pointers, then the value
+template <typename K, typename V, typename C, typename A>
+size_t HeapBytes(const map<K, V, C, A> &m) {
+  const size_t node = 4 * sizeof(void *) + sizeof(pair<const K, V>);
+  size_t bytes = 0;
+  for (const auto &value : m)
+    bytes += AllocationBytes(node) + HeapBytes(value);
+  return bytes;
+}
+
+// Estimated size of one data structure of the benchmark
+struct StructureMemory {
+  string name;
+  size_t entries = 0;
+  size_t bytes = 0;
+
+  // table "memory": entries, bytes and bytes per loaded record
+  ResultRow ToRow(size_t records) const;
+};
+
+// The largest estimated size of every structure during a data set
+class MemoryReport {
+public:
+  void Add(const string &name, size_t entries, size_t bytes);
+  void AddRows(size_t records, ResultWriter &writer) const;
+
+private:
+  vector<StructureMemory> structures_;
+};
@@ -0,0 +1,102 @@
+#include "numa.h"
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <cstdio>
+#include <fstream>
+#include <sched.h>
+#include <sstream>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace fs = boost::filesystem;
+
+// from linux/mempolicy.h, which is not installed everywhere
+static const int kMemoryPolicyBind = 2;
+static const int kMemoryPolicyInterleave = 3;
+// node ids the masks can hold
+static const size_t kMaxNodes = 1024;
+static const size_t kMaskBits = 8 * sizeof(unsigned long);
+
+// "0-3,8,10-11" to its CPUs
+static vector<int> ParseCpuList(const string &list) {
+  vector<int> cpus;
+  stringstream ss(list);
+  string range;
+  while (getline(ss, range, ',')) {
+    int first, last;
+    int n = sscanf(range.c_str(), "%d-%d", &first, &last);
+    if (n < 1)
+      continue;
+    if (n == 1)
+      last = first;
+    for (int cpu = first; cpu <= last; ++cpu)
+      cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+vector<NumaNode> NumaNodes() {
+  vector<NumaNode> nodes;
+  const fs::path directory = "/sys/devices/system/node";
+  boost::system::error_code error;
+  for (fs::directory_iterator it(directory, error), end; !error && it != end;
+       it.increment(error)) {
+    const string name = it->path().filename().string();
+    int id;
+    if (name.compare(0, 4, "node") != 0 ||
+        sscanf(name.c_str() + 4, "%d", &id) != 1 || id < 0 ||
+        (size_t)id >= kMaxNodes)
+      continue;
+    ifstream fin((it->path() / "cpulist").string());
+    string list;
+    getline(fin, list);
+    NumaNode node{id, ParseCpuList(list)};
+    if (!node.cpus.empty())
+      nodes.push_back(node);
+  }
+  if (!nodes.empty()) {
+    sort(nodes.begin(), nodes.end(),
+         [](const NumaNode &a, const NumaNode &b) { return a.id < b.id; });
+    return nodes;
+  }
+
+  NumaNode node{0, {}};
+  cpu_set_t set;
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set))
+        node.cpus.push_back(cpu);
+    }
+  }
+  return {node};
+}
+
+bool PinThread(const NumaNode &node) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : node.cpus) {
+    if (cpu < CPU_SETSIZE)
+      CPU_SET(cpu, &set);
+  }
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+static bool SetMemoryPolicy(int mode, const vector<const NumaNode *> &nodes) {
+  unsigned long mask[kMaxNodes / kMaskBits] = {};
+  for (const NumaNode *node : nodes)
+    mask[node->id / kMaskBits] |= 1UL << (node->id % kMaskBits);
+  // the kernel reads one bit less than maxnode
+  return syscall(SYS_set_mempolicy, mode, mask, kMaxNodes + 1) == 0;
+}
+
+bool BindThreadMemory(const NumaNode &node) {
+  return SetMemoryPolicy(kMemoryPolicyBind, {&node});
+}
+
+bool InterleaveThreadMemory(const vector<NumaNode> &nodes) {
+  vector<const NumaNode *> all;
+  for (const NumaNode &node : nodes)
+    all.push_back(&node);
+  return SetMemoryPolicy(kMemoryPolicyInterleave, all);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+enum NumaPlacement : uint8_t {
+  // the base groups are partitioned over the nodes, the workers of a node are
+  // pinned to its CPUs and allocate from its memory
+  kLocalPlacement,
+  // any worker runs any base group anywhere, the memory is interleaved over
+  // the nodes
+  kInterleavedPlacement,
+  kNumberOfNumaPlacement
+};
+
+const static string numa_placement_name[kNumberOfNumaPlacement]{
+    "local", "interleaved"};
+
+inline string ToString(NumaPlacement placement) {
+  return numa_placement_name[placement];
+}
+
+struct NumaNode {
+  int id;
+  vector<int> cpus;
+};
+
+// The online nodes with CPUs, from /sys/devices/system/node. One node 0 with
+// the CPUs the process may run on if the kernel has no NUMA support.
+vector<NumaNode> NumaNodes();
+
+// Run the calling thread on the CPUs of node only
+bool PinThread(const NumaNode &node);
+
+// Allocate the pages the calling thread touches first from now on from node
+// only, or interleaved over nodes, with set_mempolicy(2), the thread wide
+// form of mbind(2). Returns false if the kernel refuses, e.g. without NUMA
+// support.
+bool BindThreadMemory(const NumaNode &node);
+bool InterleaveThreadMemory(const vector<NumaNode> &nodes);
@@ -1,8 +1,70 @@
 #include "odess_similarity_detection.h"
+#include "memory_usage.h"
+#include "util/coding.h"
 #include "util/gear_matrix.h"
 
+#include <algorithm>
 #include <cassert>
-#include <random>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+static const char kSnapshotMagic[] = "FIT1";
+static const size_t kSnapshotMagicSize = 4;
+
+void FeatureParameters::EncodeTo(string *dst) const {
+  dst->push_back(static_cast<char>(detector));
+  PutFixed64(dst, sample_mask);
+  PutVarint32(dst, feature_number);
+  PutVarint32(dst, super_feature_number);
+  PutVarint32(dst, max_scan_bytes);
+  PutFixed64(dst, seed);
+}
+
+const char *FeatureParameters::DecodeFrom(const char *p, const char *limit) {
+  uint32_t features, super_features, max_scan;
+  if (p == limit || static_cast<uint8_t>(*p) >= kNumberOfSimilarityDetector)
+    return nullptr;
+  detector = static_cast<SimilarityDetectorType>(*p++);
+  if (limit - p < 8)
+    return nullptr;
+  sample_mask = DecodeFixed64(p);
+  p += 8;
+  p = GetVarint32Ptr(p, limit, &features);
+  if (p != nullptr)
+    p = GetVarint32Ptr(p, limit, &super_features);
+  if (p != nullptr)
+    p = GetVarint32Ptr(p, limit, &max_scan);
+  if (p == nullptr || limit - p < 8)
+    return nullptr;
+  seed = DecodeFixed64(p);
+  feature_number = features;
+  super_feature_number = super_features;
+  max_scan_bytes = max_scan;
+  if (super_feature_number == 0 || feature_number % super_feature_number != 0)
+    return nullptr;
+  return p + 8;
+}
+
+bool FeatureParameters::operator==(const FeatureParameters &other) const {
+  return detector == other.detector && sample_mask == other.sample_mask &&
+         feature_number == other.feature_number &&
+         super_feature_number == other.super_feature_number &&
+         max_scan_bytes == other.max_scan_bytes && seed == other.seed;
+}
+
+// SplitMix64, so the arguments don't depend on the standard library
+vector<feature_t> SeededArguments(uint64_t seed, size_t number) {
+  vector<feature_t> args(number);
+  for (size_t i = 0; i < number; ++i) {
+    feature_t z = (seed += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    args[i] = z ^ (z >> 31);
+  }
+  return args;
+}
+
 void FeatureIndexTable::Delete(const string &key) {
   SuperFeatures super_features;
   if (GetSuperFeatures(key, &super_features)) {
@@ -10,23 +72,35 @@ void FeatureIndexTable::Delete(const string &key) {
   }
 }
 
+FeatureIndexTable::KeySet &FeatureIndexTable::KeysOf(super_feature_t sf) {
+  auto it = feature_key_table_.find(sf);
+  if (it == feature_key_table_.end())
+    it = feature_key_table_
+             .emplace(sf, KeySet(feature_key_table_.get_allocator()))
+             .first;
+  return it->second;
+}
+
 void FeatureIndexTable::ExecuteDelete(const string &key,
                                       const SuperFeatures &super_features) {
   for (const super_feature_t &sf : super_features) {
-    feature_key_table_[sf].erase(key);
+    KeysOf(sf).erase(key);
   }
   key_feature_table_.erase(key);
 }
 
 void FeatureIndexTable::Put(const string &key, const string &value) {
-  SuperFeatures super_features;
+  PutSuperFeatures(key, feature_generator_->GenerateSuperFeatures(value));
+}
+
+void FeatureIndexTable::PutSuperFeatures(const string &key,
+                                         const SuperFeatures &super_features) {
   // delete old feature if it exits so we can insert a new one
   Delete(key);
 
-  super_features = feature_generator_.GenerateSuperFeatures(value);
   key_feature_table_[key] = super_features;
   for (const super_feature_t &sf : super_features) {
-    feature_key_table_[sf].insert(key);
+    KeysOf(sf).insert(key);
   }
 }
 
@@ -45,7 +119,7 @@ size_t FeatureIndexTable::CountAllSimilarRecords() const{
   size_t num = 0;
   unordered_set<string> similar_keys;
   for (const auto &it : feature_key_table_) {
-    auto keys = it.second;
+    const auto &keys = it.second;
 
     // If there are more than one records have the same feature,
     // thoese keys are considered similar
@@ -57,6 +131,90 @@ size_t FeatureIndexTable::CountAllSimilarRecords() const{
   return similar_keys.size();
 }
 
+size_t FeatureIndexTable::FeatureKeyTableBytes() const {
+  return HeapBytes(feature_key_table_);
+}
+
+size_t FeatureIndexTable::KeyFeatureTableBytes() const {
+  return HeapBytes(key_feature_table_);
+}
+
+vector<string> FeatureIndexTable::Keys() const {
+  vector<string> keys;
+  keys.reserve(key_feature_table_.size());
+  for (const auto &it : key_feature_table_)
+    keys.push_back(it.first);
+  return keys;
+}
+
+bool FeatureIndexTable::Save(const string &path) const {
+  string snapshot(kSnapshotMagic, kSnapshotMagicSize);
+  parameters_.EncodeTo(&snapshot);
+  PutVarint32(&snapshot, key_feature_table_.size());
+  for (const auto &it : key_feature_table_) {
+    PutVarint32(&snapshot, it.first.size());
+    snapshot.append(it.first);
+    for (super_feature_t sf : it.second)
+      PutFixed64(&snapshot, sf);
+  }
+
+  ofstream fout(path, ios::binary);
+  if (!fout.write(snapshot.data(), snapshot.size())) {
+    cerr << "can't write the feature index to " << path << endl;
+    return false;
+  }
+  return true;
+}
+
+bool FeatureIndexTable::Load(const string &path) {
+  ifstream fin(path, ios::binary);
+  string snapshot((istreambuf_iterator<char>(fin)), istreambuf_iterator<char>());
+  const char *p = snapshot.data();
+  const char *limit = p + snapshot.size();
+  if (!fin || snapshot.compare(0, kSnapshotMagicSize, kSnapshotMagic) != 0) {
+    cerr << path << " is not a feature index snapshot" << endl;
+    return false;
+  }
+  p += kSnapshotMagicSize;
+
+  FeatureParameters parameters;
+  uint32_t records = 0;
+  p = parameters.DecodeFrom(p, limit);
+  if (p != nullptr)
+    p = GetVarint32Ptr(p, limit, &records);
+  decltype(key_feature_table_) key_feature_table(
+      key_feature_table_.get_allocator());
+  for (uint32_t i = 0; p != nullptr && i < records; ++i) {
+    uint32_t key_length;
+    p = GetVarint32Ptr(p, limit, &key_length);
+    if (p == nullptr ||
+        (size_t)(limit - p) <
+            key_length + 8 * parameters.super_feature_number) {
+      p = nullptr;
+      break;
+    }
+    SuperFeatures &super_features =
+        key_feature_table[string(p, key_length)];
+    p += key_length;
+    for (size_t j = 0; j < parameters.super_feature_number; ++j, p += 8)
+      super_features.push_back(DecodeFixed64(p));
+  }
+  if (p == nullptr) {
+    cerr << "corrupted feature index snapshot " << path << endl;
+    return false;
+  }
+
+  parameters_ = parameters;
+  feature_generator_ = NewSimilarityDetector(parameters);
+  key_feature_table_.swap(key_feature_table);
+  feature_key_table_.clear();
+  for (const auto &it : key_feature_table_) {
+    for (super_feature_t sf : it.second)
+      KeysOf(sf).insert(it.first);
+  }
+  return true;
+}
+
 void FeatureIndexTable::GetSimilarRecordsKeys(const string &key,
                                               vector<string> &similar_keys) {
   SuperFeatures super_features;
@@ -64,10 +222,12 @@ void FeatureIndexTable::GetSimilarRecordsKeys(const string &key,
     return;
   }
 
+  // A record sharing several super features is only returned once
+  unordered_set<string> found;
   for (const super_feature_t &sf : super_features) {
-    for (string similar_key : feature_key_table_[sf]) {
-      if (similar_key != key) {
-        similar_keys.emplace_back(move(similar_key));
+    for (const string &similar_key : KeysOf(sf)) {
+      if (similar_key != key && found.insert(similar_key).second) {
+        similar_keys.emplace_back(similar_key);
       }
     }
   }
@@ -78,33 +238,88 @@ void FeatureIndexTable::GetSimilarRecordsKeys(const string &key,
   ExecuteDelete(key, super_features);
 }
 
-FeatureGenerator::FeatureGenerator(feature_t sample_mask, size_t feature_number,
-                                   size_t super_feature_number)
-    : kSampleRatioMask(sample_mask), kFeatureNumber(feature_number),
-      kSuperFeatureNumber(super_feature_number) {
+void FeatureIndexTable::FindSimilarRecordsKeys(
+    const string &key, vector<string> &similar_keys) const {
+  auto it = key_feature_table_.find(key);
+  if (it == key_feature_table_.end())
+    return;
+
+  unordered_set<string> found;
+  for (const super_feature_t &sf : it->second) {
+    auto keys = feature_key_table_.find(sf);
+    if (keys == feature_key_table_.end())
+      continue;
+    for (const string &similar_key : keys->second) {
+      if (similar_key != key && found.insert(similar_key).second)
+        similar_keys.emplace_back(similar_key);
+    }
+  }
+}
+
+FeatureGenerator::FeatureGenerator(const FeatureParameters &parameters)
+    : kSampleRatioMask(parameters.sample_mask),
+      kFeatureNumber(parameters.feature_number),
+      kSuperFeatureNumber(parameters.super_feature_number),
+      kMaxScanBytes(parameters.max_scan_bytes) {
   assert(kFeatureNumber % kSuperFeatureNumber == 0);
 
-  std::random_device rd;
-  std::default_random_engine e(rd());
-  std::uniform_int_distribution<feature_t> dis(0, UINT64_MAX);
+  vector<feature_t> args = SeededArguments(parameters.seed, 2 * kFeatureNumber);
+  random_transform_args_a_.assign(args.begin(), args.begin() + kFeatureNumber);
+  random_transform_args_b_.assign(args.begin() + kFeatureNumber, args.end());
+  features_.assign(kFeatureNumber, 0);
+}
+
+void FeatureGenerator::Transform(feature_t hash) {
+  for (size_t j = 0; j < kFeatureNumber; ++j) {
+    feature_t transform_res =
+        hash * random_transform_args_a_[j] + random_transform_args_b_[j];
+    features_[j] = max(features_[j], transform_res);
+  }
+}
 
-  features_.resize(kFeatureNumber);
-  random_transform_args_a_.resize(kFeatureNumber);
-  random_transform_args_b_.resize(kFeatureNumber);
+// Sampled positions are rare, so the branch is almost always predicted
+inline void FeatureGenerator::Roll(feature_t &hash, uint8_t byte) {
+  hash = (hash << 1) + GEARmx[byte];
+  if (__builtin_expect(!(hash & kSampleRatioMask), 0))
+    Transform(hash);
+}
 
-  for (size_t i = 0; i < kFeatureNumber; ++i) {
-    #ifdef FIX_TRANSFORM_ARGUMENT_TO_KEEP_SAME_SIMILARITY_DETECTION_BETWEEN_TESTS
-    random_transform_args_a_[i] = GEARmx[i];
-    random_transform_args_b_[i] = GEARmx[kFeatureNumber+i];
-    #else
-    random_transform_args_a_[i] = dis(e);
-    random_transform_args_b_[i] = dis(e);
-    #endif
-    features_[i] = 0;
+void FeatureGenerator::ScanRegion(const uint8_t *data, size_t size) {
+  feature_t hash = 0;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    Roll(hash, data[i]);
+    Roll(hash, data[i + 1]);
+    Roll(hash, data[i + 2]);
+    Roll(hash, data[i + 3]);
+    Roll(hash, data[i + 4]);
+    Roll(hash, data[i + 5]);
+    Roll(hash, data[i + 6]);
+    Roll(hash, data[i + 7]);
   }
+  for (; i < size; ++i)
+    Roll(hash, data[i]);
 }
 
+// A value longer than kMaxScanBytes is scanned in kScanRegions regions of
+// kMaxScanBytes / kScanRegions bytes, evenly spread from its start to its
+// end. The Gear hash only depends on the last 64 bytes, so the regions don't
+// need to overlap.
 void FeatureGenerator::OdessResemblanceDetect(const string &value) {
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(value.data());
+  if (kMaxScanBytes == 0 || value.size() <= kMaxScanBytes) {
+    ScanRegion(data, value.size());
+    return;
+  }
+  size_t region_size = max<size_t>(kMaxScanBytes / kScanRegions, 1);
+  size_t stride = (value.size() - region_size) / (kScanRegions - 1);
+  for (size_t r = 0; r < kScanRegions; ++r)
+    ScanRegion(data + r * stride, region_size);
+}
+
+SuperFeatures
+FeatureGenerator::GenerateSuperFeaturesByteByByte(const string &value) {
+  CleanFeatures();
   feature_t hash = 0;
   for (size_t i = 0; i < value.size(); ++i) {
     hash = (hash << 1) + GEARmx[static_cast<uint8_t>(value[i])];
@@ -117,26 +332,19 @@ void FeatureGenerator::OdessResemblanceDetect(const string &value) {
       }
     }
   }
-}
-
-SuperFeatures FeatureGenerator::MakeSuperFeatures() {
-  if (kSuperFeatureNumber == kFeatureNumber)
-    return CopyFeaturesAsSuperFeatures();
-  else
-    return GroupFeaturesAsSuperFeatures();
-}
-
-SuperFeatures FeatureGenerator::CopyFeaturesAsSuperFeatures() {
-  SuperFeatures super_features(features_.begin(), features_.end());
-  return super_features;
+  return GroupFeatures(features_, kSuperFeatureNumber);
 }
 
 // Divede features into groups, then use the group hash as the super feature
-SuperFeatures FeatureGenerator::GroupFeaturesAsSuperFeatures() {
-  SuperFeatures super_features(kSuperFeatureNumber);
-  for (size_t i = 0; i < kSuperFeatureNumber; ++i) {
-    size_t group_len = kFeatureNumber / kSuperFeatureNumber;
-    super_features[i] = XXH64(&features_[i * group_len],
+SuperFeatures GroupFeatures(const vector<feature_t> &features,
+                            size_t super_feature_number) {
+  if (super_feature_number == features.size())
+    return SuperFeatures(features.begin(), features.end());
+
+  SuperFeatures super_features(super_feature_number);
+  size_t group_len = features.size() / super_feature_number;
+  for (size_t i = 0; i < super_feature_number; ++i) {
+    super_features[i] = XXH64(&features[i * group_len],
                               sizeof(feature_t) * group_len, 0x7fcaf1);
   }
   return super_features;
@@ -151,5 +359,5 @@ void FeatureGenerator::CleanFeatures() {
 SuperFeatures FeatureGenerator::GenerateSuperFeatures(const string &value) {
   CleanFeatures();
   OdessResemblanceDetect(value);
-  return MakeSuperFeatures();
+  return GroupFeatures(features_, kSuperFeatureNumber);
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
+#include "arena.h"
 #include <cstdint>
 #include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -29,23 +31,99 @@ const feature_t k1_128RatioMask = 0x0000400303410000;
 // 1/(2^2)=1/4
 const feature_t k1_4RatioMask = 0x0000000100000001;
 
-// #define FIX_TRANSFORM_ARGUMENT_TO_KEEP_SAME_SIMILARITY_DETECTION_BETWEEN_TESTS
+enum SimilarityDetectorType : uint8_t {
+  kOdess,      // content defined sampling, see FeatureGenerator
+  kNTransform, // every window, see NTransformGenerator
+  kFinesse,    // fixed subchunks, see FinesseGenerator
+  kMinHash,    // min-wise hashing with LSH bands, see MinHashGenerator
+  kNumberOfSimilarityDetector
+};
+
+const static string detector_name[kNumberOfSimilarityDetector]{
+    "odess", "n-transform", "finesse", "minhash"};
+
+inline string ToString(SimilarityDetectorType type) {
+  return detector_name[type];
+}
+
+// Everything the super features of a value depend on. Super features are
+// only comparable if they are generated with equal parameters, so the
+// parameters are stored with persisted features, see FeatureIndexTable::Save().
+//
+// The transform arguments and hash seeds of the detectors are generated from
+// seed by SeededArguments(), the same on every platform and run.
+//
+// Encoded format:
+//    +----------+-------------+----------+----------------+----------+---------+
+//    | detector | sample mask | features | super features | max scan |  seed   |
+//    +----------+-------------+----------+----------------+----------+---------+
+//    |  1 byte  |   Fixed64   | Varint32 |    Varint32    | Varint32 | Fixed64 |
+//    +----------+-------------+----------+----------------+----------+---------+
+struct FeatureParameters {
+  static const uint64_t kDefaultSeed = 0x7fcaf1;
+
+  SimilarityDetectorType detector = kOdess;
+  // only used by kOdess
+  feature_t sample_mask = k1_128RatioMask;
+  size_t feature_number = 12;
+  // The super feature are used for similarity detection. The more of super
+  // features a record have, the bigger feature index table will be.
+  size_t super_feature_number = 3;
+  // only used by kOdess, see FeatureGenerator::OdessResemblanceDetect()
+  size_t max_scan_bytes = 0;
+  uint64_t seed = kDefaultSeed;
+
+  void EncodeTo(string *dst) const;
+  // Returns nullptr on a truncated or invalid encoding, or the end of the
+  // encoding
+  const char *DecodeFrom(const char *p, const char *limit);
+
+  bool operator==(const FeatureParameters &other) const;
+  bool operator!=(const FeatureParameters &other) const {
+    return !(*this == other);
+  }
+};
+
+// number of pseudo random arguments generated from seed by SplitMix64
+vector<feature_t> SeededArguments(uint64_t seed, size_t number);
+
+// Generates the super features of a record. Two records sharing a super
+// feature are considered similar.
+class SimilarityDetector {
+public:
+  virtual ~SimilarityDetector() {}
+
+  virtual SuperFeatures GenerateSuperFeatures(const string &value) = 0;
+};
+
+unique_ptr<SimilarityDetector>
+NewSimilarityDetector(const FeatureParameters &parameters);
+
+// Hash every group of feature_number / super_feature_number features into one
+// super feature, or use the features as they are if the numbers are equal
+SuperFeatures GroupFeatures(const vector<feature_t> &features,
+                            size_t super_feature_number);
 
-class FeatureGenerator {
+class FeatureGenerator : public SimilarityDetector {
 public:
-  static const feature_t kDefaultSampleRatioMask = k1_128RatioMask;
-  static const size_t kDefaultFeatureNumber = 12;
-  static const size_t kDefaultSuperFeatureNumber = 3;
+  // A capped value is scanned in this many regions spread over the value
+  static const size_t kScanRegions = 8;
 
   /**
    * @description: Detect records similarity. Then we can use delta compression
    * to compress the similar values.
+   * @param parameters.max_scan_bytes scan at most this many bytes of a value,
+   * 0 to scan all of it. Less bytes are faster on huge values but find less
+   * similar records, see --sweep-max-scan-bytes.
    */
-  FeatureGenerator(feature_t sample_mask = kDefaultSampleRatioMask,
-                   size_t feature_number = kDefaultFeatureNumber,
-                   size_t super_feature_number = kDefaultSuperFeatureNumber);
+  explicit FeatureGenerator(
+      const FeatureParameters &parameters = FeatureParameters());
 
-  SuperFeatures GenerateSuperFeatures(const string &value);
+  SuperFeatures GenerateSuperFeatures(const string &value) override;
+
+  // The byte by byte loop of OdessResemblanceDetect() without the unrolling
+  // and the scan cap, to compare with in the micro benchmarks
+  SuperFeatures GenerateSuperFeaturesByteByByte(const string &value);
 
 private:
   /**
@@ -59,13 +137,12 @@ private:
    */
   void OdessResemblanceDetect(const string &value);
 
-  /**
-   * @description: Divide the features into kSuperFeatureNumber groups. Use
-   * xxhash on each groups of feature to generate hash value as super feature.
-   */
-  SuperFeatures MakeSuperFeatures();
-  SuperFeatures GroupFeaturesAsSuperFeatures();
-  SuperFeatures CopyFeaturesAsSuperFeatures();
+  // Gear hash the region from its start, unrolled 8 bytes at a time so the
+  // hash, the sample test and the loop overhead don't serialize per byte.
+  void ScanRegion(const uint8_t *data, size_t size);
+  void Roll(feature_t &hash, uint8_t byte);
+  void Transform(feature_t hash);
+
   void CleanFeatures();
 
   vector<feature_t> features_;
@@ -73,23 +150,31 @@ private:
   vector<feature_t> random_transform_args_b_;
 
   const feature_t kSampleRatioMask;
-  // The super feature are used for similarity detection. The more of super
-// features a record have, the bigger feature index table will be.
   const size_t kFeatureNumber;
   const size_t kSuperFeatureNumber;
+  const size_t kMaxScanBytes;
 };
 
 class FeatureIndexTable {
 public:
-  FeatureIndexTable(){};
-  FeatureIndexTable(feature_t sample_mask, size_t feature_number,
-                    size_t super_feature_number)
-      : feature_generator_(sample_mask, feature_number, super_feature_number){};
+  // The tables are allocated from arena if it is given, which must outlive
+  // the table
+  explicit FeatureIndexTable(
+      const FeatureParameters &parameters = FeatureParameters(),
+      Arena *arena = nullptr)
+      : parameters_(parameters),
+        feature_key_table_(ArenaAllocator<char>(arena)),
+        key_feature_table_(ArenaAllocator<char>(arena)),
+        feature_generator_(NewSimilarityDetector(parameters)){};
 
   // generate the super features of the value
   // index the key-feature
   void Put(const string &key, const string &value);
 
+  // Like Put(), with the super features generated by the caller, e.g. on
+  // another thread with its own SimilarityDetector of Parameters()
+  void PutSuperFeatures(const string &key, const SuperFeatures &super_features);
+
   // Delete (key, feature_number of super feature) pair and
   // feature_number of (super feature,key) pairs
   void Delete(const string &key);
@@ -98,13 +183,51 @@ public:
   // After that, remove key from the key-feature table
   void GetSimilarRecordsKeys(const string &key, vector<string> &similar_keys);
 
+  // Like GetSimilarRecordsKeys(), but leaves the tables unchanged
+  void FindSimilarRecordsKeys(const string &key,
+                              vector<string> &similar_keys) const;
+
   // count all similar records that can be delta compressed
   size_t CountAllSimilarRecords() const;
 
+  // Estimated heap bytes of the two tables, see memory_usage.h
+  size_t FeatureKeyTableBytes() const;
+  size_t KeyFeatureTableBytes() const;
+  size_t Size() const { return key_feature_table_.size(); }
+  bool Contains(const string &key) const {
+    return key_feature_table_.count(key) != 0;
+  }
+  vector<string> Keys() const;
+  const FeatureParameters &Parameters() const { return parameters_; }
+
+  // Write the parameters and the super features of every key to path, so
+  // they can be loaded in another process instead of generated again.
+  //
+  // Snapshot format:
+  //    +--------+------------+----------+-------------+----------------+-----+
+  //    | magic  | parameters | records  | key         | super features | ... |
+  //    +--------+------------+----------+-------------+----------------+-----+
+  //    | "FIT1" |            | Varint32 | Varint32    | Fixed64 each   |     |
+  //    |        |            |          | length, key |                |     |
+  //    +--------+------------+----------+-------------+----------------+-----+
+  // A key is followed by parameters.super_feature_number super features.
+  bool Save(const string &path) const;
+
+  // Replace the table and the parameters with the snapshot at path. Puts
+  // after the load generate super features with the loaded parameters, so
+  // the index can be extended incrementally.
+  bool Load(const string &path);
+
 private:
-  unordered_map<super_feature_t, unordered_set<string>> feature_key_table_;
-  map<string, SuperFeatures> key_feature_table_;
-  FeatureGenerator feature_generator_;
+  typedef ArenaHashSet<string> KeySet;
+
+  FeatureParameters parameters_;
+  ArenaHashMap<super_feature_t, KeySet> feature_key_table_;
+  ArenaMap<string, SuperFeatures> key_feature_table_;
+  unique_ptr<SimilarityDetector> feature_generator_;
+
+  // The keys of sf, an empty set in the arena of the table if there are none
+  KeySet &KeysOf(super_feature_t sf);
 
   void ExecuteDelete(const string &key, const SuperFeatures &super_features);
 
@@ -0,0 +1,151 @@
+#include "online_store.h"
+
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
+
+OnlineStore::OnlineStore(const FeatureParameters &parameters,
+                         DeltaCompressType type)
+    : kType(type), index_(parameters), shards_(new Shard[kShards]) {}
+
+OnlineStore::Shard &OnlineStore::ShardOf(const string &key) const {
+  return shards_[hash<string>()(key) % kShards];
+}
+
+shared_ptr<const OnlineStore::Record>
+OnlineStore::Find(const string &key) const {
+  Shard &shard = ShardOf(key);
+  lock_guard<mutex> lock(shard.lock);
+  auto it = shard.records.find(key);
+  return it == shard.records.end() ? nullptr : it->second;
+}
+
+bool OnlineStore::Put(SimilarityDetector &detector, const string &key,
+                      const string &value, PutTimes *times) {
+  struct timespec start, indexed, compressed;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  SuperFeatures super_features = detector.GenerateSuperFeatures(value);
+  clock_gettime(CLOCK_MONOTONIC, &indexed);
+  AddElapsedTime(times->features, start, indexed);
+
+  // Put replaces the features of an older version
+  vector<string> similar_keys;
+  {
+    lock_guard<mutex> lock(index_lock_);
+    index_.PutSuperFeatures(key, super_features);
+    index_.FindSimilarRecordsKeys(key, similar_keys);
+  }
+  shared_ptr<const Record> base;
+  for (const string &similar_key : similar_keys) {
+    base = Find(similar_key);
+    if (base && base->delta.empty())
+      break;
+    base = nullptr;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  AddElapsedTime(times->index, indexed, start);
+
+  shared_ptr<Record> record = make_shared<Record>();
+  if (base && !value.empty() && !base->value->empty() &&
+      DeltaCompress(kType, value, *base->value, &record->delta) &&
+      record->delta.size() < value.size()) {
+    record->value = base->value;
+  } else {
+    record->delta.clear();
+    record->value = make_shared<const string>(value);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &compressed);
+  AddElapsedTime(times->compress, start, compressed);
+
+  const bool delta = !record->delta.empty();
+  if (delta) {
+    // a delta is no base, the later records find the base itself
+    lock_guard<mutex> lock(index_lock_);
+    index_.Delete(key);
+  }
+  Shard &shard = ShardOf(key);
+  lock_guard<mutex> lock(shard.lock);
+  shard.records[key] = move(record);
+  return delta;
+}
+
+bool OnlineStore::Get(const string &key, string *value) const {
+  shared_ptr<const Record> record = Find(key);
+  if (!record)
+    return false;
+  if (record->delta.empty()) {
+    *value = *record->value;
+    return true;
+  }
+  value->clear();
+  return DeltaUncompress(kType, record->delta, *record->value, value);
+}
+
+uintmax_t OnlineStore::StoredBytes(uintmax_t *pinned_bytes) const {
+  uintmax_t bytes = 0;
+  unordered_set<const string *> current, bases;
+  for (size_t i = 0; i < kShards; ++i) {
+    lock_guard<mutex> lock(shards_[i].lock);
+    for (const auto &it : shards_[i].records) {
+      const Record &record = *it.second;
+      if (record.delta.empty()) {
+        bytes += record.value->size();
+        current.insert(record.value.get());
+      } else {
+        bytes += record.delta.size();
+        bases.insert(record.value.get());
+      }
+    }
+  }
+  *pinned_bytes = 0;
+  for (const string *base : bases) {
+    if (!current.count(base))
+      *pinned_bytes += base->size();
+  }
+  return bytes + *pinned_bytes;
+}
+
+void OnlineResult::Merge(const OnlineResult &other) {
+  const timespec zero{};
+  inserts += other.inserts;
+  updates += other.updates;
+  delta_records += other.delta_records;
+  reads += other.reads;
+  read_fails += other.read_fails;
+  AddElapsedTime(put_times.features, zero, other.put_times.features);
+  AddElapsedTime(put_times.index, zero, other.put_times.index);
+  AddElapsedTime(put_times.compress, zero, other.put_times.compress);
+  write_latencies.insert(write_latencies.end(), other.write_latencies.begin(),
+                         other.write_latencies.end());
+  read_latencies.insert(read_latencies.end(), other.read_latencies.begin(),
+                        other.read_latencies.end());
+}
+
+ResultRow OnlineResult::ToRow() {
+  sort(write_latencies.begin(), write_latencies.end());
+  sort(read_latencies.begin(), read_latencies.end());
+  const double seconds = TimespecToSeconds(wall_time);
+  const size_t writes = inserts + updates;
+  ResultRow row("online");
+  row.AddText("method", method);
+  row.AddCount("writers", writers);
+  row.AddCount("readers", readers);
+  row.AddCount("inserts", inserts);
+  row.AddCount("updates", updates);
+  row.AddCount("deltas", delta_records);
+  row.AddNumber("ratio", stored_size ? (double)original_size / stored_size : 0,
+                3);
+  row.AddSize("pinned bytes", pinned_size);
+  row.AddNumber("writes/s", seconds > 0 ? writes / seconds : 0, 0);
+  row.AddNumber("write p50 us", Percentile(write_latencies, 50));
+  row.AddNumber("write p99 us", Percentile(write_latencies, 99));
+  row.AddSeconds("features time", put_times.features);
+  row.AddSeconds("index time", put_times.index);
+  row.AddSeconds("compress time", put_times.compress);
+  row.AddCount("reads", reads);
+  row.AddCount("read fails", read_fails);
+  row.AddNumber("reads/s", seconds > 0 ? reads / seconds : 0, 0);
+  row.AddNumber("read p50 us", Percentile(read_latencies, 50));
+  row.AddNumber("read p99 us", Percentile(read_latencies, 99));
+  return row;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include "delta_compress.h"
+#include "odess_similarity_detection.h"
+#include "statistics.h"
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// A key-value store delta compressing every record on Put against a similar
+// record of its feature index, the way delta compression is embedded in a
+// KV store. Put and Get may be called from any number of threads.
+//
+// Only records stored as they are serve as bases, so every Get decodes at
+// most one delta. A delta holds the version of its base it is compressed
+// against, so a base can be updated or deleted while its deltas are read.
+class OnlineStore {
+public:
+  OnlineStore(const FeatureParameters &parameters, DeltaCompressType type);
+
+  // Time of the steps of one Put
+  struct PutTimes {
+    timespec features{};
+    // index update and base lookup, including the wait for the lock
+    timespec index{};
+    timespec compress{};
+  };
+
+  // Store value under key, replacing the old value, with the super features
+  // generated by detector, which must be a SimilarityDetector of the
+  // parameters of the store that no other thread uses.
+  // Returns true if value is stored as a delta.
+  bool Put(SimilarityDetector &detector, const string &key,
+           const string &value, PutTimes *times);
+
+  // false if key is not stored or its delta doesn't decode
+  bool Get(const string &key, string *value) const;
+
+  // bytes of the current version of every record, as a delta or as it is,
+  // and of the old base versions the deltas still hold, which are also put
+  // into pinned_bytes. Call it while no thread puts.
+  uintmax_t StoredBytes(uintmax_t *pinned_bytes) const;
+
+private:
+  struct Record {
+    // the value if it is stored as it is, otherwise the base version
+    shared_ptr<const string> value;
+    // empty if the value is stored as it is
+    string delta;
+  };
+
+  // the records are spread over shards by key hash, so the threads rarely
+  // wait for the same lock
+  static const size_t kShards = 64;
+  struct Shard {
+    mutable mutex lock;
+    unordered_map<string, shared_ptr<const Record>> records;
+  };
+
+  Shard &ShardOf(const string &key) const;
+  shared_ptr<const Record> Find(const string &key) const;
+
+  const DeltaCompressType kType;
+  mutex index_lock_;
+  FeatureIndexTable index_;
+  unique_ptr<Shard[]> shards_;
+};
+
+// One run of the online mode with one delta compression method
+struct OnlineResult {
+  string method;
+  size_t writers = 0;
+  size_t readers = 0;
+  timespec wall_time{};
+
+  size_t inserts = 0;
+  size_t updates = 0;
+  // writes stored as deltas
+  size_t delta_records = 0;
+  size_t reads = 0;
+  size_t read_fails = 0;
+  uintmax_t original_size = 0;
+  // pinned_size included
+  uintmax_t stored_size = 0;
+  // old base versions only deltas refer to
+  uintmax_t pinned_size = 0;
+  // summed over the writers
+  OnlineStore::PutTimes put_times;
+  // in microseconds, sorted by ToRow()
+  vector<double> write_latencies;
+  vector<double> read_latencies;
+
+  // Add up the counts and latencies of another thread
+  void Merge(const OnlineResult &other);
+  // table "online"
+  ResultRow ToRow();
+};
@@ -0,0 +1,35 @@
+#include "oracle.h"
+
+void OracleStatistics::Add(const OracleQuery &query) {
+  ++samples;
+  good_pairs += query.good_pairs;
+  candidates += query.candidates;
+  good_candidates += query.good_candidates;
+  records_with_good_pair += query.good_pairs > 0;
+  records_with_good_candidate += query.good_candidates > 0;
+  original_size += query.size;
+  oracle_size += query.oracle_size;
+  detector_size += query.detector_size;
+}
+
+static double Ratio(uintmax_t a, uintmax_t b) { return b ? (double)a / b : 0; }
+
+ResultRow OracleStatistics::ToRow() const {
+  const double oracle_ratio = Ratio(original_size, oracle_size);
+  const double detector_ratio = Ratio(original_size, detector_size);
+  ResultRow row("oracle");
+  row.AddText("method", method);
+  row.AddCount("samples", samples);
+  row.AddCount("candidates", candidates);
+  row.AddCount("good candidates", good_candidates);
+  row.AddCount("good pairs", good_pairs);
+  row.AddNumber("precision", Ratio(good_candidates, candidates), 3);
+  row.AddNumber("pair recall", Ratio(good_candidates, good_pairs), 3);
+  row.AddNumber("record recall",
+                Ratio(records_with_good_candidate, records_with_good_pair), 3);
+  row.AddNumber("oracle ratio", oracle_ratio, 3);
+  row.AddNumber("detector ratio", detector_ratio, 3);
+  row.AddNumber("ratio lost %",
+                oracle_ratio ? 100 * (1 - detector_ratio / oracle_ratio) : 0);
+  return row;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "statistics.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+// Brute force result of one sampled record: it is delta compressed against
+// every other record of the data set.
+struct OracleQuery {
+  size_t size = 0;
+  // other records it delta compresses well against
+  size_t good_pairs = 0;
+  // records FeatureIndexTable returns as similar, and how many of them are
+  // good pairs
+  size_t candidates = 0;
+  size_t good_candidates = 0;
+  // smallest good delta against any record / against a candidate, the
+  // record size if there is none
+  size_t oracle_size = 0;
+  size_t detector_size = 0;
+};
+
+// Precision and recall of the similarity detection against the brute force
+// ground truth over the sampled records
+struct OracleStatistics {
+  string method;
+  size_t samples = 0;
+  size_t good_pairs = 0;
+  size_t candidates = 0;
+  size_t good_candidates = 0;
+  // sampled records with at least one good pair / one good candidate
+  size_t records_with_good_pair = 0;
+  size_t records_with_good_candidate = 0;
+  uintmax_t original_size = 0;
+  uintmax_t oracle_size = 0;
+  uintmax_t detector_size = 0;
+
+  void Add(const OracleQuery &query);
+
+  // table "oracle":
+  //   precision: good candidates / candidates
+  //   pair recall: good candidates / good pairs
+  //   record recall: records with a good candidate / with a good pair
+  //   ratio lost: how much lower the ratio of the best candidates is than
+  //   the ratio of the best bases
+  ResultRow ToRow() const;
+};
@@ -0,0 +1,269 @@
+#include "partitioned_index.h"
+#include "util/coding.h"
+#include "util/xxhash.h"
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+namespace fs = boost::filesystem;
+
+typedef ArenaHashMap<string, string>::value_type KeyValue;
+
+static size_t ShardOf(const string &key, size_t partitions) {
+  return XXH64(key.data(), key.size(), 0x5a17) % partitions;
+}
+
+static size_t OwnerOf(super_feature_t super_feature, size_t partitions) {
+  return XXH64(&super_feature, sizeof(super_feature), 0x5a17) % partitions;
+}
+
+static string PostingsPath(const string &directory, size_t shard,
+                           size_t partition) {
+  return directory + "/postings." + to_string(shard) + "." +
+         to_string(partition);
+}
+
+static string GroupsPath(const string &directory, size_t partition) {
+  return directory + "/groups." + to_string(partition);
+}
+
+static bool WriteFile(const string &path, const string &data) {
+  ofstream fout(path, ios::binary);
+  if (!fout.write(data.data(), data.size())) {
+    cerr << "can't write " << path << endl;
+    return false;
+  }
+  return true;
+}
+
+static bool ReadFile(const string &path, string *data) {
+  ifstream fin(path, ios::binary);
+  if (!fin) {
+    cerr << "can't read " << path << endl;
+    return false;
+  }
+  data->assign(istreambuf_iterator<char>(fin), istreambuf_iterator<char>());
+  return true;
+}
+
+// Reads one length prefixed key, returns nullptr on a truncated file
+static const char *GetKey(const char *p, const char *limit, string *key) {
+  uint32_t length;
+  p = GetVarint32Ptr(p, limit, &length);
+  if (p == nullptr || (size_t)(limit - p) < length)
+    return nullptr;
+  key->assign(p, length);
+  return p + length;
+}
+
+static bool MapShard(const vector<const KeyValue *> &records,
+                     const FeatureParameters &parameters, size_t partitions,
+                     const string &directory, size_t shard) {
+  unique_ptr<SimilarityDetector> detector = NewSimilarityDetector(parameters);
+  vector<string> postings(partitions);
+  for (const KeyValue *record : records) {
+    const string &key = record->first;
+    for (super_feature_t sf : detector->GenerateSuperFeatures(record->second)) {
+      string &out = postings[OwnerOf(sf, partitions)];
+      PutFixed64(&out, sf);
+      PutVarint32(&out, key.size());
+      out.append(key);
+    }
+  }
+  for (size_t p = 0; p < partitions; ++p) {
+    if (!WriteFile(PostingsPath(directory, shard, p), postings[p]))
+      return false;
+  }
+  return true;
+}
+
+static bool ReducePartition(size_t partitions, const string &directory,
+                            size_t partition) {
+  unordered_map<super_feature_t, vector<string>> index;
+  for (size_t shard = 0; shard < partitions; ++shard) {
+    string postings;
+    if (!ReadFile(PostingsPath(directory, shard, partition), &postings))
+      return false;
+    const char *p = postings.data();
+    const char *limit = p + postings.size();
+    while (p < limit) {
+      if (limit - p < 8)
+        return false;
+      vector<string> &keys = index[DecodeFixed64(p)];
+      keys.emplace_back();
+      p = GetKey(p + 8, limit, &keys.back());
+      if (p == nullptr)
+        return false;
+    }
+  }
+
+  string groups;
+  for (auto &it : index) {
+    // a record can emit the same super feature twice, e.g. the all-zero
+    // features of a short record, that is no second record
+    vector<string> &keys = it.second;
+    sort(keys.begin(), keys.end());
+    keys.erase(unique(keys.begin(), keys.end()), keys.end());
+    if (keys.size() < 2)
+      continue;
+    PutVarint32(&groups, keys.size());
+    for (const string &key : keys) {
+      PutVarint32(&groups, key.size());
+      groups.append(key);
+    }
+  }
+  return WriteFile(GroupsPath(directory, partition), groups);
+}
+
+// Fork one process per partition running work(partition), and wait for all.
+// Returns false if a process can't be forked or fails.
+template <typename Work>
+static bool ForkAndWait(size_t partitions, Work work, timespec *time) {
+  struct timespec start, stop;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  vector<pid_t> children;
+  bool ok = true;
+  for (size_t p = 0; p < partitions; ++p) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      // skip the destructors and atexit handlers of the parent
+      _exit(work(p) ? 0 : 1);
+    }
+    if (pid < 0) {
+      perror("fork");
+      ok = false;
+      break;
+    }
+    children.push_back(pid);
+  }
+  for (pid_t pid : children) {
+    int status;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0)
+      ok = false;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  AddElapsedTime(*time, start, stop);
+  return ok;
+}
+
+static bool Merge(size_t partitions, const string &directory,
+                  PartitionedIndexResult *result) {
+  unordered_set<string> candidates;
+  for (size_t partition = 0; partition < partitions; ++partition) {
+    string groups;
+    if (!ReadFile(GroupsPath(directory, partition), &groups))
+      return false;
+    const char *p = groups.data();
+    const char *limit = p + groups.size();
+    while (p < limit) {
+      uint32_t keys;
+      p = GetVarint32Ptr(p, limit, &keys);
+      vector<size_t> shard_keys(partitions);
+      for (uint32_t i = 0; p != nullptr && i < keys; ++i) {
+        string key;
+        p = GetKey(p, limit, &key);
+        ++shard_keys[ShardOf(key, partitions)];
+        candidates.insert(move(key));
+      }
+      if (p == nullptr) {
+        cerr << "corrupted " << GroupsPath(directory, partition) << endl;
+        return false;
+      }
+      uintmax_t same_shard_pairs = 0;
+      for (size_t n : shard_keys)
+        same_shard_pairs += n > 1 ? (uintmax_t)n * (n - 1) / 2 : 0;
+      uintmax_t pairs = (uintmax_t)keys * (keys - 1) / 2;
+      result->posting_pairs += pairs;
+      result->cross_shard_posting_pairs += pairs - same_shard_pairs;
+    }
+  }
+  result->candidate_records = candidates.size();
+  return true;
+}
+
+bool RunPartitionedIndex(const ArenaHashMap<string, string> &key_value,
+                         const FeatureParameters &parameters,
+                         size_t partitions, const string &directory,
+                         PartitionedIndexResult *result) {
+  struct timespec start, stop;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  result->partitions = partitions;
+  result->records = key_value.size();
+
+  vector<vector<const KeyValue *>> shards(partitions);
+  for (const KeyValue &record : key_value)
+    shards[ShardOf(record.first, partitions)].push_back(&record);
+
+  string pattern = directory + "/deltabench.XXXXXX";
+  if (mkdtemp(&pattern[0]) == nullptr) {
+    perror(("can't create a directory under " + directory).c_str());
+    return false;
+  }
+  const string work_directory = pattern;
+
+  bool ok = ForkAndWait(
+      partitions,
+      [&](size_t shard) {
+        return MapShard(shards[shard], parameters, partitions, work_directory,
+                        shard);
+      },
+      &result->map_time);
+  if (ok) {
+    for (size_t shard = 0; shard < partitions; ++shard) {
+      for (size_t p = 0; p < partitions; ++p)
+        result->shuffle_bytes +=
+            fs::file_size(PostingsPath(work_directory, shard, p));
+    }
+    result->postings = key_value.size() * parameters.super_feature_number;
+    ok = ForkAndWait(
+        partitions,
+        [&](size_t partition) {
+          return ReducePartition(partitions, work_directory, partition);
+        },
+        &result->reduce_time);
+  }
+  if (ok) {
+    struct timespec merge_start, merge_stop;
+    clock_gettime(CLOCK_MONOTONIC, &merge_start);
+    ok = Merge(partitions, work_directory, result);
+    clock_gettime(CLOCK_MONOTONIC, &merge_stop);
+    AddElapsedTime(result->merge_time, merge_start, merge_stop);
+  }
+  if (!ok)
+    cerr << "partitioned index with " << partitions << " processes failed"
+         << endl;
+
+  boost::system::error_code error;
+  fs::remove_all(work_directory, error);
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  AddElapsedTime(result->wall_time, start, stop);
+  return ok;
+}
+
+ResultRow PartitionedIndexResult::ToRow() const {
+  double seconds = TimespecToSeconds(wall_time);
+  ResultRow row("partitions");
+  row.AddCount("processes", partitions);
+  row.AddCount("postings", postings);
+  row.AddSize("shuffle bytes", shuffle_bytes);
+  row.AddSeconds("map time", map_time);
+  row.AddSeconds("reduce time", reduce_time);
+  row.AddSeconds("merge time", merge_time);
+  row.AddSeconds("wall time", wall_time);
+  row.AddNumber("records/s", seconds > 0 ? records / seconds : 0, 0);
+  row.AddNumber("speedup", speedup);
+  row.AddCount("candidates", candidate_records);
+  row.AddCount("posting pairs", posting_pairs);
+  row.AddCount("cross-shard posting pairs", cross_shard_posting_pairs);
+  return row;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "arena.h"
+#include "odess_similarity_detection.h"
+#include "statistics.h"
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+// Similarity detection with the feature index split over processes, the way
+// it runs when the records are spread over several nodes:
+//
+//   map:    the records are sharded by key hash. One process per shard
+//           generates the super features of its records and sends every
+//           (super feature, key) posting to the partition owning the super
+//           feature hash.
+//   reduce: one process per partition builds its part of the index from the
+//           postings of all shards and reports the groups of keys sharing a
+//           super feature, including the keys of different shards.
+//   merge:  the parent collects the groups.
+//
+// The processes are forked and the transport is files in a directory, so no
+// service is needed. Every process generates the features with the same
+// FeatureParameters, which makes the super features of different shards
+// comparable.
+//
+// Postings file shard -> partition, one entry per posting:
+//    +---------------+------------+-----+
+//    | super feature | key length | key |
+//    +---------------+------------+-----+
+//    |    Fixed64    |  Varint32  |     |
+//    +---------------+------------+-----+
+// Groups file of a partition, one entry per super feature of several distinct
+// keys:
+//    +----------+------------+-----+-----+
+//    |   keys   | key length | key | ... |
+//    +----------+------------+-----+-----+
+//    | Varint32 |  Varint32  |     |     |
+//    +----------+------------+-----+-----+
+struct PartitionedIndexResult {
+  size_t partitions = 0;
+  size_t records = 0;
+  size_t postings = 0;
+  uintmax_t shuffle_bytes = 0;
+  timespec map_time{};
+  timespec reduce_time{};
+  timespec merge_time{};
+  timespec wall_time{};
+
+  // records sharing a super feature with another record
+  size_t candidate_records = 0;
+  // pairs of keys sharing a super feature, summed over the super features,
+  // and how many of them are in different shards. Two records sharing k
+  // super features are k posting pairs, so this is the work of comparing
+  // the candidates, not a count of distinct similar pairs.
+  uintmax_t posting_pairs = 0;
+  uintmax_t cross_shard_posting_pairs = 0;
+  // wall time of the first result / this one, set by the caller
+  double speedup = 0;
+
+  // table "partitions"
+  ResultRow ToRow() const;
+};
+
+// Run the map, reduce and merge over the records with the given number of
+// processes. The transport files are written to a new directory under
+// directory, which is removed at the end.
+// Returns false and prints the reason if a process fails.
+bool RunPartitionedIndex(const ArenaHashMap<string, string> &key_value,
+                         const FeatureParameters &parameters,
+                         size_t partitions, const string &directory,
+                         PartitionedIndexResult *result);
@@ -0,0 +1,129 @@
+#include "perf_counters.h"
+#include "statistics.h"
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int PerfEventOpen(perf_event_attr *attr, int group_fd) {
+  // pid 0 and cpu -1: the calling thread on any CPU
+  return syscall(__NR_perf_event_open, attr, 0, -1, group_fd, 0);
+}
+
+static void SetEvent(PerfEventType type, perf_event_attr *attr) {
+  switch (type) {
+  case kCycles:
+    attr->type = PERF_TYPE_HARDWARE;
+    attr->config = PERF_COUNT_HW_CPU_CYCLES;
+    break;
+  case kInstructions:
+    attr->type = PERF_TYPE_HARDWARE;
+    attr->config = PERF_COUNT_HW_INSTRUCTIONS;
+    break;
+  case kLLCMisses:
+    attr->type = PERF_TYPE_HARDWARE;
+    attr->config = PERF_COUNT_HW_CACHE_MISSES;
+    break;
+  case kBranchMisses:
+    attr->type = PERF_TYPE_HARDWARE;
+    attr->config = PERF_COUNT_HW_BRANCH_MISSES;
+    break;
+  case kDTLBMisses:
+  default:
+    attr->type = PERF_TYPE_HW_CACHE;
+    attr->config = PERF_COUNT_HW_CACHE_DTLB |
+                   (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    break;
+  }
+}
+
+PerfCounters::PerfCounters() {
+  for (uint8_t i = 0; i < kNumberOfPerfEvent; ++i) {
+    fds_[i] = -1;
+    ids_[i] = 0;
+
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    SetEvent((PerfEventType)i, &attr);
+    attr.disabled = group_fd_ < 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID |
+                       PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    int fd = PerfEventOpen(&attr, group_fd_);
+    if (fd < 0) {
+      // Without the cycles leader there is nothing to group the others in
+      if (i == kCycles)
+        return;
+      continue;
+    }
+    fds_[i] = fd;
+    if (i == kCycles)
+      group_fd_ = fd;
+    ioctl(fd, PERF_EVENT_IOC_ID, &ids_[i]);
+  }
+  ioctl(group_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(group_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounters::~PerfCounters() {
+  for (int fd : fds_) {
+    if (fd >= 0)
+      close(fd);
+  }
+}
+
+// read(2) format of a group with PERF_FORMAT_GROUP | PERF_FORMAT_ID |
+// PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING
+//
+//    +----+--------------+--------------+-------+----+-----+
+//    | nr | time enabled | time running | value | id | ... |
+//    +----+--------------+--------------+-------+----+-----+
+//    | u64|      u64     |      u64     |  u64  | u64|     |
+//    +----+--------------+--------------+-------+----+-----+
+void PerfCounters::Read(PerfCounts *counts) {
+  if (group_fd_ < 0)
+    return;
+  uint64_t buffer[3 + 2 * kNumberOfPerfEvent];
+  if (read(group_fd_, buffer, sizeof(buffer)) < (ssize_t)(3 * sizeof(uint64_t)))
+    return;
+  const uint64_t nr = buffer[0];
+  const uint64_t enabled = buffer[1];
+  const uint64_t running = buffer[2];
+  for (uint64_t n = 0; n < nr && n < kNumberOfPerfEvent; ++n) {
+    uint64_t value = buffer[3 + 2 * n];
+    uint64_t id = buffer[4 + 2 * n];
+    if (running && running < enabled)
+      value = (uint64_t)((double)value * enabled / running);
+    for (uint8_t i = 0; i < kNumberOfPerfEvent; ++i) {
+      if (fds_[i] >= 0 && ids_[i] == id)
+        counts->value[i] = value;
+    }
+  }
+}
+
+void PerfCounts::Add(const PerfCounts &start, const PerfCounts &stop) {
+  for (uint8_t i = 0; i < kNumberOfPerfEvent; ++i)
+    value[i] += stop.value[i] - start.value[i];
+}
+
+void PerfCounts::Merge(const PerfCounts &other) {
+  for (uint8_t i = 0; i < kNumberOfPerfEvent; ++i)
+    value[i] += other.value[i];
+  bytes += other.bytes;
+}
+
+ResultRow PerfCounts::ToRow(const string &method) const {
+  ResultRow row("perf");
+  row.AddText("method", method);
+  for (uint8_t i = 0; i < kNumberOfPerfEvent; ++i)
+    row.AddCount(ToString((PerfEventType)i), value[i]);
+  row.AddNumber("IPC", (double)value[kInstructions] / value[kCycles]);
+  row.AddNumber("cycles/byte", (double)value[kCycles] / bytes);
+  return row;
+}
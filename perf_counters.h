@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+struct ResultRow;
+
+enum PerfEventType : uint8_t {
+  kCycles,
+  kInstructions,
+  kLLCMisses,
+  kBranchMisses,
+  kDTLBMisses, // data TLB read misses
+  kNumberOfPerfEvent
+};
+
+const static string perf_event_name[kNumberOfPerfEvent]{
+    "cycles", "instructions", "LLC misses", "branch misses", "dTLB misses"};
+
+inline string ToString(PerfEventType type) { return perf_event_name[type]; }
+
+// Hardware event counts, plus the bytes processed while they were counted
+struct PerfCounts {
+  uint64_t value[kNumberOfPerfEvent] = {};
+  uintmax_t bytes = 0;
+
+  // Add the events between two readings of PerfCounters
+  void Add(const PerfCounts &start, const PerfCounts &stop);
+  // Add up the counts of another thread
+  void Merge(const PerfCounts &other);
+
+  // table "perf": cycles, instructions, IPC, misses and cycles/byte
+  ResultRow ToRow(const string &method) const;
+};
+
+// Counts the hardware events of the calling thread in user space with
+// perf_event_open(2). The counters run from construction to destruction, and
+// Read() is cheap enough to be called around every compress call.
+//
+// Without a PMU or permission (see /proc/sys/kernel/perf_event_paranoid)
+// Available() is false and Read() leaves the counts zero. Events the CPU
+// doesn't support are left zero as well.
+class PerfCounters {
+public:
+  PerfCounters();
+  ~PerfCounters();
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  bool Available() const { return group_fd_ >= 0; }
+
+  // Current counts since construction, scaled if the counters were
+  // multiplexed with other users of the PMU
+  void Read(PerfCounts *counts);
+
+private:
+  int group_fd_ = -1;
+  int fds_[kNumberOfPerfEvent];
+  uint64_t ids_[kNumberOfPerfEvent];
+};
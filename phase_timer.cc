@@ -0,0 +1,58 @@
+#include "phase_timer.h"
+#include "memory_usage.h"
+#include <vector>
+
+// Peak RSS of every open tracked scope, innermost last. VmHWM is reset when
+// a scope begins, so the peaks seen by inner scopes are carried out to the
+// scopes around them.
+static vector<size_t> open_scope_peaks;
+
+static void CarryPeakRss() {
+  const size_t peak = PeakResidentBytes();
+  for (size_t &scope_peak : open_scope_peaks)
+    scope_peak = max(scope_peak, peak);
+}
+
+void ScopedPhaseTimer::BeginPeakRss() {
+  CarryPeakRss();
+  open_scope_peaks.push_back(0);
+  ResetPeakResidentBytes();
+}
+
+size_t ScopedPhaseTimer::EndPeakRss() {
+  CarryPeakRss();
+  const size_t peak = open_scope_peaks.back();
+  open_scope_peaks.pop_back();
+  return peak;
+}
+
+ResultRow PhaseStatistics::ToRow() const {
+  const double seconds = TimespecToSeconds(time);
+  ResultRow row("phases");
+  row.AddText("phase", name);
+  row.AddSeconds("time", time);
+  row.AddCount("records", records);
+  row.AddSize("bytes", bytes);
+  row.AddNumber("MB/s", Throughput(bytes, time));
+  row.AddNumber("records/s", seconds > 0 ? records / seconds : 0, 0);
+  if (peak_rss)
+    row.AddSize("peak RSS", peak_rss);
+  else
+    row.AddMissing("peak RSS");
+  return row;
+}
+
+PhaseStatistics &PhaseRegistry::Phase(const string &name) {
+  for (PhaseStatistics &phase : phases_) {
+    if (phase.name == name)
+      return phase;
+  }
+  phases_.emplace_back();
+  phases_.back().name = name;
+  return phases_.back();
+}
+
+void PhaseRegistry::AddRows(ResultWriter &writer) const {
+  for (const PhaseStatistics &phase : phases_)
+    writer.Add(phase.ToRow());
+}
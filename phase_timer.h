@@ -0,0 +1,82 @@
+#pragma once
+#include "statistics.h"
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <string>
+
+using namespace std;
+
+// Wall time spent in one phase of the pipeline, with the records and bytes
+// that went through it
+struct PhaseStatistics {
+  string name;
+  timespec time{};
+  size_t records = 0;
+  uintmax_t bytes = 0;
+  // peak RSS of the process during the phase, 0 if it is not tracked or
+  // /proc/self/status can't be read
+  size_t peak_rss = 0;
+
+  // table "phases": time, records, bytes, MB/s, records/s and peak RSS
+  ResultRow ToRow() const;
+};
+
+// Phases of one data set in the order they first run. A phase named
+// "parent/child" is a part of the time of phase "parent".
+//
+// Not thread safe, phases are timed on the main thread around the parallel
+// parts.
+class PhaseRegistry {
+public:
+  // The phase with this name, created if it doesn't exist. The reference
+  // stays valid until Clear().
+  PhaseStatistics &Phase(const string &name);
+  void Clear() { phases_.clear(); }
+
+  void AddRows(ResultWriter &writer) const;
+
+private:
+  // a deque keeps references valid when new phases are added
+  deque<PhaseStatistics> phases_;
+};
+
+// Adds the time from construction to destruction to a phase.
+//
+// With track_peak_rss it also records the peak RSS of the scope, which costs
+// a few system calls, so per-record scopes leave it off. Tracked scopes must
+// nest, like the phases do.
+class ScopedPhaseTimer {
+public:
+  explicit ScopedPhaseTimer(PhaseStatistics &phase, bool track_peak_rss = true)
+      : phase_(phase), track_peak_rss_(track_peak_rss) {
+    if (track_peak_rss_)
+      BeginPeakRss();
+    clock_gettime(CLOCK_MONOTONIC, &start_);
+  }
+  ScopedPhaseTimer(PhaseRegistry &registry, const string &name)
+      : ScopedPhaseTimer(registry.Phase(name)) {}
+  ~ScopedPhaseTimer() {
+    struct timespec stop;
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    AddElapsedTime(phase_.time, start_, stop);
+    if (track_peak_rss_)
+      phase_.peak_rss = max(phase_.peak_rss, EndPeakRss());
+  }
+  ScopedPhaseTimer(const ScopedPhaseTimer &) = delete;
+  ScopedPhaseTimer &operator=(const ScopedPhaseTimer &) = delete;
+
+  void AddRecords(size_t records, uintmax_t bytes) {
+    phase_.records += records;
+    phase_.bytes += bytes;
+  }
+
+private:
+  static void BeginPeakRss();
+  static size_t EndPeakRss();
+
+  PhaseStatistics &phase_;
+  const bool track_peak_rss_;
+  struct timespec start_;
+};
@@ -0,0 +1,86 @@
+#include "read_replay.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+ReadKeyGenerator::ReadKeyGenerator(ReadDistribution distribution, size_t n,
+                                   double theta, uint64_t seed)
+    : kDistribution(distribution), kN(n), kTheta(theta), random_(seed) {
+  if (kDistribution == kUniformReads || kN < 2)
+    return;
+  zetan_ = 0;
+  for (size_t i = 1; i <= kN; ++i)
+    zetan_ += 1 / pow(i, kTheta);
+  const double zeta2 = 1 + pow(0.5, kTheta);
+  alpha_ = 1 / (1 - kTheta);
+  eta_ = (1 - pow(2. / kN, 1 - kTheta)) / (1 - zeta2 / zetan_);
+  if (kDistribution == kZipfianReads) {
+    permutation_.resize(kN);
+    for (size_t i = 0; i < kN; ++i)
+      permutation_[i] = i;
+    shuffle(permutation_.begin(), permutation_.end(), random_);
+  }
+}
+
+size_t ReadKeyGenerator::NextRank() {
+  const double u = uniform_real_distribution<double>(0, 1)(random_);
+  const double uz = u * zetan_;
+  if (uz < 1)
+    return 0;
+  if (uz < 1 + pow(0.5, kTheta))
+    return 1;
+  return min<size_t>(kN * pow(eta_ * u - eta_ + 1, alpha_), kN - 1);
+}
+
+size_t ReadKeyGenerator::Next() {
+  if (kN < 2)
+    return 0;
+  switch (kDistribution) {
+  case kZipfianReads:
+    return permutation_[NextRank()];
+  case kLatestReads:
+    return kN - 1 - NextRank();
+  default:
+    return uniform_int_distribution<size_t>(0, kN - 1)(random_);
+  }
+}
+
+ResultRow ReadReplayResult::ToRow() {
+  sort(latencies.begin(), latencies.end());
+  double seconds = TimespecToSeconds(wall_time);
+  ResultRow row("read replay");
+  row.AddText("method", method);
+  row.AddText("store", store);
+  row.AddText("distribution", distribution);
+  row.AddCount("threads", threads);
+  row.AddText("cache", to_string(cache_percent) + "%");
+  row.AddSize("cache bytes", cache_bytes);
+  row.AddCount("reads", reads);
+  row.AddCount("failed", failed);
+  size_t fetches = hits + misses;
+  row.AddNumber("hit rate", fetches ? (double)hits / fetches : 0, 3);
+  row.AddCount("evictions", evictions);
+  row.AddNumber("ops/s", seconds > 0 ? reads / seconds : 0, 0);
+  row.AddNumber("fetch us", reads ? fetch_seconds * 1e6 / reads : 0);
+  row.AddNumber("decode us", reads ? decode_seconds * 1e6 / reads : 0);
+  row.AddNumber("p50 us", Percentile(latencies, 50));
+  row.AddNumber("p99 us", Percentile(latencies, 99));
+  row.AddNumber("p99.9 us", Percentile(latencies, 99.9));
+  return row;
+}
+
+bool ReadTraceFile(const string &path, vector<string> *keys) {
+  ifstream fin(path);
+  if (!fin) {
+    cerr << "can't read " << path << endl;
+    return false;
+  }
+  string key;
+  while (getline(fin, key)) {
+    if (!key.empty())
+      keys->push_back(key);
+  }
+  return true;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "statistics.h"
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+enum ReadDistribution : uint8_t {
+  kUniformReads,
+  kZipfianReads, // a few hot keys, spread over the key space
+  kLatestReads,  // zipfian, the hot keys are the last written ones
+  kNumberOfReadDistribution
+};
+
+const static string read_distribution_name[kNumberOfReadDistribution]{
+    "uniform", "zipfian", "latest"};
+
+inline string ToString(ReadDistribution distribution) {
+  return read_distribution_name[distribution];
+}
+
+// Draws the indexes in [0, n) of keys in write order. The zipfian ranks are
+// drawn with the generator of YCSB, theta in (0, 1) is the skew.
+class ReadKeyGenerator {
+public:
+  ReadKeyGenerator(ReadDistribution distribution, size_t n, double theta,
+                   uint64_t seed);
+
+  size_t Next();
+
+private:
+  size_t NextRank();
+
+  const ReadDistribution kDistribution;
+  const size_t kN;
+  const double kTheta;
+  double zetan_;
+  double alpha_;
+  double eta_;
+  mt19937_64 random_;
+  // zipfian ranks to key indexes, so the hot keys are not neighbours
+  vector<size_t> permutation_;
+};
+
+// Point reads of delta compressed records replayed through a BaseCache: every
+// read fetches the base of the delta from the cache, or the BaseStore behind
+// it on a miss, then decodes the delta. The latency of a read includes both.
+struct ReadReplayResult {
+  string method;
+  string store;
+  // a ReadDistribution or "trace"
+  string distribution;
+  size_t threads = 1;
+  // cache size in percent of the bytes of all bases
+  size_t cache_percent = 0;
+  size_t cache_bytes = 0;
+
+  // successful reads, ops/s, the times and the latencies are only of these
+  size_t reads = 0;
+  // the base can't be fetched or the delta doesn't decode
+  size_t failed = 0;
+  // of all fetches, failed reads included
+  size_t hits = 0;
+  size_t misses = 0;
+  size_t evictions = 0;
+  // decoded bytes
+  uintmax_t read_bytes = 0;
+  // summed over the threads
+  double fetch_seconds = 0;
+  double decode_seconds = 0;
+  timespec wall_time{};
+  // of every successful read in microseconds, sorted by ToRow()
+  vector<double> latencies;
+
+  // table "read replay"
+  ResultRow ToRow();
+};
+
+// The keys of a trace file, one per line. Returns false and prints the
+// reason if it can't be read.
+bool ReadTraceFile(const string &path, vector<string> *keys);
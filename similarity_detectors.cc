@@ -0,0 +1,138 @@
+#include "similarity_detectors.h"
+#include "util/gear_matrix.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+
+unique_ptr<SimilarityDetector>
+NewSimilarityDetector(const FeatureParameters &parameters) {
+  switch (parameters.detector) {
+  case kNTransform:
+    return unique_ptr<SimilarityDetector>(new NTransformGenerator(parameters));
+  case kFinesse:
+    return unique_ptr<SimilarityDetector>(new FinesseGenerator(parameters));
+  case kMinHash:
+    return unique_ptr<SimilarityDetector>(new MinHashGenerator(parameters));
+  default:
+    return unique_ptr<SimilarityDetector>(new FeatureGenerator(parameters));
+  }
+}
+
+// Polynomial rolling hash of the last kWindowSize bytes, the Rabin-Karp form
+// of the Rabin fingerprint the N-transform and Finesse papers use
+class RollingHash {
+public:
+  static const size_t kWindowSize = 48;
+  static const feature_t kBase = 0x100000001b3;
+
+  RollingHash() {
+    for (size_t i = 0; i < kWindowSize; ++i)
+      out_factor_ *= kBase;
+  }
+
+  // Returns the hash of the window ending at value[i], call it for every i
+  // in order
+  feature_t Roll(const string &value, size_t i) {
+    hash_ = hash_ * kBase + static_cast<uint8_t>(value[i]);
+    if (i >= kWindowSize)
+      hash_ -= out_factor_ * static_cast<uint8_t>(value[i - kWindowSize]);
+    return hash_;
+  }
+
+private:
+  feature_t hash_ = 0;
+  feature_t out_factor_ = 1;
+};
+
+NTransformGenerator::NTransformGenerator(const FeatureParameters &parameters)
+    : features_(parameters.feature_number),
+      kFeatureNumber(parameters.feature_number),
+      kSuperFeatureNumber(parameters.super_feature_number) {
+  assert(kFeatureNumber % kSuperFeatureNumber == 0);
+  vector<feature_t> args = SeededArguments(parameters.seed, 2 * kFeatureNumber);
+  random_transform_args_a_.assign(args.begin(), args.begin() + kFeatureNumber);
+  random_transform_args_b_.assign(args.begin() + kFeatureNumber, args.end());
+}
+
+SuperFeatures NTransformGenerator::GenerateSuperFeatures(const string &value) {
+  fill(features_.begin(), features_.end(), 0);
+  RollingHash rolling_hash;
+  for (size_t i = 0; i < value.size(); ++i) {
+    feature_t hash = rolling_hash.Roll(value, i);
+    for (size_t j = 0; j < kFeatureNumber; ++j) {
+      feature_t transform_res =
+          hash * random_transform_args_a_[j] + random_transform_args_b_[j];
+      if (transform_res > features_[j])
+        features_[j] = transform_res;
+    }
+  }
+  return GroupFeatures(features_, kSuperFeatureNumber);
+}
+
+FinesseGenerator::FinesseGenerator(const FeatureParameters &parameters)
+    : features_(parameters.feature_number),
+      grouped_features_(parameters.feature_number),
+      kFeatureNumber(parameters.feature_number),
+      kSuperFeatureNumber(parameters.super_feature_number) {
+  assert(kFeatureNumber % kSuperFeatureNumber == 0);
+}
+
+SuperFeatures FinesseGenerator::GenerateSuperFeatures(const string &value) {
+  fill(features_.begin(), features_.end(), 0);
+  RollingHash rolling_hash;
+  size_t subchunk = 0;
+  size_t subchunk_end = value.size() / kFeatureNumber;
+  for (size_t i = 0; i < value.size(); ++i) {
+    while (i >= subchunk_end && subchunk + 1 < kFeatureNumber) {
+      ++subchunk;
+      subchunk_end = (subchunk + 1) * value.size() / kFeatureNumber;
+    }
+    feature_t hash = rolling_hash.Roll(value, i);
+    if (hash > features_[subchunk])
+      features_[subchunk] = hash;
+  }
+
+  // A small edit changes the maximum of one subchunk, sorting the groups
+  // keeps the rank of the other features
+  size_t groups = kFeatureNumber / kSuperFeatureNumber;
+  for (size_t g = 0; g < groups; ++g) {
+    auto begin = features_.begin() + g * kSuperFeatureNumber;
+    sort(begin, begin + kSuperFeatureNumber, greater<feature_t>());
+    for (size_t j = 0; j < kSuperFeatureNumber; ++j)
+      grouped_features_[j * groups + g] = features_[g * kSuperFeatureNumber + j];
+  }
+  return GroupFeatures(grouped_features_, kSuperFeatureNumber);
+}
+
+MinHashGenerator::MinHashGenerator(const FeatureParameters &parameters)
+    : features_(parameters.feature_number),
+      hash_seeds_(SeededArguments(parameters.seed, parameters.feature_number)),
+      kFeatureNumber(parameters.feature_number),
+      kSuperFeatureNumber(parameters.super_feature_number) {
+  assert(kFeatureNumber % kSuperFeatureNumber == 0);
+}
+
+// The finalizer of MurmurHash3
+static inline feature_t Mix(feature_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+SuperFeatures MinHashGenerator::GenerateSuperFeatures(const string &value) {
+  fill(features_.begin(), features_.end(), UINT64_MAX);
+  feature_t hash = 0;
+  for (size_t i = 0; i < value.size(); ++i) {
+    hash = (hash << 1) + GEARmx[static_cast<uint8_t>(value[i])];
+    for (size_t j = 0; j < kFeatureNumber; ++j) {
+      feature_t min_hash = Mix(hash ^ hash_seeds_[j]);
+      if (min_hash < features_[j])
+        features_[j] = min_hash;
+    }
+  }
+  return GroupFeatures(features_, kSuperFeatureNumber);
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "odess_similarity_detection.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// The alternatives to Odess (FeatureGenerator). They are selected with
+// NewSimilarityDetector() and compared side by side by the sweep mode.
+
+// N-transform super features (Broder; Shilane et al., "WAN Optimized
+// Replication of Backup Datasets Using Stream-Informed Delta Compression"):
+// the fingerprint of every window goes through all the linear transforms and
+// each feature is the maximum of one transform. Like Odess without the
+// content defined sampling, so about 1/sample rate times more transforms.
+class NTransformGenerator : public SimilarityDetector {
+public:
+  explicit NTransformGenerator(const FeatureParameters &parameters);
+
+  SuperFeatures GenerateSuperFeatures(const string &value) override;
+
+private:
+  vector<feature_t> features_;
+  vector<feature_t> random_transform_args_a_;
+  vector<feature_t> random_transform_args_b_;
+
+  const size_t kFeatureNumber;
+  const size_t kSuperFeatureNumber;
+};
+
+// Finesse (Zhang et al., "Finesse: Fine-Grained Feature Locality based Fast
+// Resemblance Detection for Post-Deduplication Delta Compression"): the
+// record is cut into feature_number fixed size subchunks and the feature of
+// a subchunk is its maximum window fingerprint, so there are no transforms.
+// The features are sorted in groups of super_feature_number, and the j-th
+// super feature hashes the j-th largest feature of every group.
+class FinesseGenerator : public SimilarityDetector {
+public:
+  explicit FinesseGenerator(const FeatureParameters &parameters);
+
+  SuperFeatures GenerateSuperFeatures(const string &value) override;
+
+private:
+  vector<feature_t> features_;
+  // features_ ordered by super feature
+  vector<feature_t> grouped_features_;
+
+  const size_t kFeatureNumber;
+  const size_t kSuperFeatureNumber;
+};
+
+// MinHash with LSH banding: every feature is the minimum of one hash
+// function over the Gear hashes of all windows, and the super features are
+// the hashes of super_feature_number bands of features. Unlike the linear
+// transforms the hash functions are independent, at the cost of a 64-bit
+// mix per window and feature.
+class MinHashGenerator : public SimilarityDetector {
+public:
+  explicit MinHashGenerator(const FeatureParameters &parameters);
+
+  SuperFeatures GenerateSuperFeatures(const string &value) override;
+
+private:
+  vector<feature_t> features_;
+  vector<feature_t> hash_seeds_;
+
+  const size_t kFeatureNumber;
+  const size_t kSuperFeatureNumber;
+};
@@ -0,0 +1,292 @@
+#include "statistics.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+static const int kMethodColumnWidth = 24;
+static const int kMinColumnWidth = 10;
+
+void AddElapsedTime(timespec &time, const timespec &start,
+                    const timespec &stop) {
+  time.tv_nsec += stop.tv_nsec - start.tv_nsec;
+  time.tv_sec += stop.tv_sec - start.tv_sec;
+  if (time.tv_nsec < 0) {
+    time.tv_nsec += 1000000000;
+    time.tv_sec--;
+  }
+  if (time.tv_nsec > 1000000000) {
+    time.tv_nsec -= 1000000000;
+    time.tv_sec++;
+  }
+}
+
+double TimespecToSeconds(const timespec &time) {
+  return time.tv_sec + time.tv_nsec / 1000000000.;
+}
+
+double Throughput(uintmax_t size, const timespec &time) {
+  double seconds = TimespecToSeconds(time);
+  return seconds > 0 ? size / seconds / (1024 * 1024) : 0;
+}
+
+double Percentile(const vector<double> &sorted, double p) {
+  if (sorted.empty())
+    return 0;
+  size_t rank = (size_t)(p / 100 * sorted.size());
+  return sorted[min(rank, sorted.size() - 1)];
+}
+
+void ResultRow::AddText(const string &name, const string &value) {
+  names.push_back(name);
+  values.push_back(value);
+  displays.push_back(value);
+  numeric.push_back(false);
+}
+
+void ResultRow::AddCount(const string &name, uintmax_t value) {
+  names.push_back(name);
+  values.push_back(to_string(value));
+  displays.push_back(to_string(value));
+  numeric.push_back(true);
+}
+
+void ResultRow::AddNumber(const string &name, double value, int precision) {
+  char buffer[64];
+  names.push_back(name);
+  if (std::isfinite(value)) {
+    snprintf(buffer, sizeof(buffer), "%.6g", value);
+    values.push_back(buffer);
+  } else {
+    values.push_back("null");
+  }
+  snprintf(buffer, sizeof(buffer), "%.*f", precision, value);
+  displays.push_back(buffer);
+  numeric.push_back(true);
+}
+
+void ResultRow::AddSize(const string &name, uintmax_t size) {
+  names.push_back(name);
+  values.push_back(to_string(size));
+  displays.push_back(HumanReadable(size).ToString(false));
+  numeric.push_back(true);
+}
+
+void ResultRow::AddSeconds(const string &name, const timespec &time) {
+  AddNumber(name, TimespecToSeconds(time));
+}
+
+void ResultRow::AddMissing(const string &name) {
+  names.push_back(name);
+  values.push_back("null");
+  displays.push_back("-");
+  numeric.push_back(true);
+}
+
+ResultWriter::ResultWriter(OutputFormat format, const string &path)
+    : format_(format), path_(path) {}
+
+void ResultWriter::BeginDataSet(const string &dataset) {
+  EndTable();
+  dataset_ = dataset;
+  datasets_.push_back(dataset);
+  last_table_.clear();
+}
+
+void ResultWriter::PrintTable() {
+  const ResultRow &head = table_rows_[0];
+  vector<int> widths;
+  for (size_t i = 0; i < head.names.size(); ++i) {
+    int width = max<int>(i ? kMinColumnWidth : kMethodColumnWidth,
+                         head.names[i].size());
+    for (const ResultRow &row : table_rows_)
+      width = max<int>(width, row.displays[i].size());
+    widths.push_back(width);
+  }
+  printf("\n");
+  for (size_t i = 0; i < head.names.size(); ++i)
+    printf("| %-*s ", widths[i], head.names[i].c_str());
+  printf("|\n");
+  for (size_t i = 0; i < head.names.size(); ++i)
+    printf("| %s ", string(widths[i], '-').c_str());
+  printf("|\n");
+  for (const ResultRow &row : table_rows_) {
+    for (size_t i = 0; i < row.names.size(); ++i)
+      printf("| %-*s ", widths[i], row.displays[i].c_str());
+    printf("|\n");
+  }
+  fflush(stdout);
+}
+
+void ResultWriter::EndTable() {
+  if (!table_rows_.empty())
+    PrintTable();
+  table_rows_.clear();
+}
+
+void ResultWriter::Add(const ResultRow &row) {
+  if (row.table != last_table_) {
+    EndTable();
+    last_table_ = row.table;
+  }
+  table_rows_.push_back(row);
+  rows_.push_back(row);
+  rows_.back().names.insert(rows_.back().names.begin(), "dataset");
+  rows_.back().values.insert(rows_.back().values.begin(), dataset_);
+  rows_.back().displays.insert(rows_.back().displays.begin(), dataset_);
+  rows_.back().numeric.insert(rows_.back().numeric.begin(), false);
+}
+
+static string JsonString(const string &s) {
+  string res = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      res += '\\';
+      res += c;
+    } else if ((unsigned char)c < 0x20) {
+      char buffer[8];
+      snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+      res += buffer;
+    } else {
+      res += c;
+    }
+  }
+  return res + '"';
+}
+
+static string CsvField(const string &s) {
+  if (s.find_first_of(",\"\n") == string::npos)
+    return s;
+  string res = "\"";
+  for (char c : s) {
+    if (c == '"')
+      res += '"';
+    res += c;
+  }
+  return res + '"';
+}
+
+// {"datasets": [...], "results": [{"dataset": ..., "table": ..., ...}, ...]}
+void ResultWriter::WriteJson(ostream &os) {
+  os << "{\n  \"datasets\": [";
+  for (size_t i = 0; i < datasets_.size(); ++i)
+    os << (i ? ", " : "") << JsonString(datasets_[i]);
+  os << "],\n  \"results\": [";
+  for (size_t r = 0; r < rows_.size(); ++r) {
+    const ResultRow &row = rows_[r];
+    os << (r ? ",\n" : "\n") << "    {\"table\": " << JsonString(row.table);
+    for (size_t i = 0; i < row.names.size(); ++i) {
+      os << ", " << JsonString(row.names[i]) << ": "
+         << (row.numeric[i] ? row.values[i] : JsonString(row.values[i]));
+    }
+    os << "}";
+  }
+  os << "\n  ]\n}\n";
+}
+
+// One CSV block per table, in the order the tables first appear
+void ResultWriter::WriteCsv(ostream &os) {
+  vector<string> tables;
+  for (const ResultRow &row : rows_) {
+    if (find(tables.begin(), tables.end(), row.table) == tables.end())
+      tables.push_back(row.table);
+  }
+  for (size_t t = 0; t < tables.size(); ++t) {
+    if (t)
+      os << "\n";
+    bool head = false;
+    for (const ResultRow &row : rows_) {
+      if (row.table != tables[t])
+        continue;
+      if (!head) {
+        os << "table";
+        for (const string &name : row.names)
+          os << "," << CsvField(name);
+        os << "\n";
+        head = true;
+      }
+      os << CsvField(row.table);
+      for (const string &value : row.values)
+        os << "," << CsvField(value);
+      os << "\n";
+    }
+  }
+}
+
+bool ResultWriter::Finish() {
+  EndTable();
+  if (format_ == kTableOutput)
+    return true;
+  ofstream fout(path_);
+  if (!fout) {
+    cerr << "can't write results to " << path_ << endl;
+    return false;
+  }
+  if (format_ == kJsonOutput)
+    WriteJson(fout);
+  else
+    WriteCsv(fout);
+  printf("results are written to %s\n", path_.c_str());
+  return true;
+}
+
+void Statistics::Merge(const Statistics &other) {
+  AddElapsedTime(compressed_time, timespec{}, other.compressed_time);
+  AddElapsedTime(uncompressed_time, timespec{}, other.uncompressed_time);
+  original_size.size_ += other.original_size.size_;
+  compressed_size.size_ += other.compressed_size.size_;
+  compress_fail += other.compress_fail;
+  compress_success += other.compress_success;
+  uncompress_fail += other.uncompress_fail;
+  compress_counts.Merge(other.compress_counts);
+  uncompress_counts.Merge(other.uncompress_counts);
+}
+
+void Statistics::AddWorkerBusyTimes(const vector<timespec> &busy_times) {
+  workers = max(workers, busy_times.size());
+  timespec max_busy{};
+  for (const timespec &busy : busy_times) {
+    AddElapsedTime(busy_time, timespec{}, busy);
+    if (TimespecToSeconds(busy) > TimespecToSeconds(max_busy))
+      max_busy = busy;
+  }
+  AddElapsedTime(max_busy_time, timespec{}, max_busy);
+}
+
+ResultRow Statistics::ToRow() const {
+  ResultRow row("compression");
+  row.AddText("method", method);
+  row.AddCount("compress success", compress_success);
+  row.AddCount("compress fail", compress_fail);
+  row.AddSize("before compressed", original_size.size_);
+  row.AddSize("after compressed", compressed_size.size_);
+  row.AddNumber("compression ratio",
+                (double)original_size.size_ / compressed_size.size_);
+  row.AddSeconds("compress time", compressed_time);
+  row.AddSeconds("uncompress time", uncompressed_time);
+  row.AddSeconds("wall time", wall_time);
+  row.AddCount("uncompress fail", uncompress_fail);
+  // the busiest worker / the mean worker, 1 if the work is spread evenly
+  const double busy = TimespecToSeconds(busy_time);
+  row.AddNumber("imbalance",
+                busy > 0 ? TimespecToSeconds(max_busy_time) * workers / busy
+                         : 0);
+  row.AddCount("steals", steals);
+  return row;
+}
+
+ResultRow StorageStatistics::ToRow() const {
+  uintmax_t stored = delta_size.size_ + self_size.size_ + raw_size.size_;
+  ResultRow row("storage");
+  row.AddText("method", method);
+  row.AddCount("delta records", delta_records);
+  row.AddCount("self compressed records", self_records);
+  row.AddCount("raw records", raw_records);
+  row.AddSize("delta size", delta_size.size_);
+  row.AddSize("self compressed size", self_size.size_);
+  row.AddSize("raw size", raw_size.size_);
+  row.AddSize("before compressed", original_size.size_);
+  row.AddSize("after compressed", stored);
+  row.AddNumber("storage saving %",
+                100. * (1 - (double)stored / original_size.size_));
+  return row;
+}
@@ -0,0 +1,167 @@
+#pragma once
+#include "perf_counters.h"
+#include <cmath>
+#include <cstdint>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct HumanReadable {
+  uintmax_t size_;
+  HumanReadable(size_t size = 0) : size_(size){};
+  std::string ToString(bool with_byte = true) {
+    int magnitude = 0;
+    double mantissa = size_;
+    while (mantissa >= 1024) {
+      mantissa /= 1024.;
+      ++magnitude;
+    }
+
+    mantissa = ceil(mantissa * 10.) / 10.;
+
+    stringstream ss;
+    ss << fixed << setprecision(2) << mantissa;
+    string res = ss.str();
+    res += "BKMGTPE"[magnitude];
+    if (magnitude)
+      res += 'B';
+    if (magnitude && with_byte)
+      res += '(' + to_string(size_) + ')';
+    return res;
+  }
+
+private:
+  friend ostream &operator<<(ostream &os, HumanReadable hr) {
+    return os << hr.ToString();
+  }
+};
+
+void AddElapsedTime(timespec &time, const timespec &start,
+                    const timespec &stop);
+
+double TimespecToSeconds(const timespec &time);
+
+// MB/s of size bytes processed in time, 0 if no time elapsed
+double Throughput(uintmax_t size, const timespec &time);
+
+// The smallest value of sorted that p percent of the values don't exceed, 0
+// if it is empty
+double Percentile(const vector<double> &sorted, double p);
+
+enum OutputFormat : uint8_t {
+  kTableOutput, // Markdown tables on stdout only
+  kJsonOutput,
+  kCsvOutput,
+  kNumberOfOutputFormat
+};
+
+const static string output_format_name[kNumberOfOutputFormat]{"table", "json",
+                                                               "csv"};
+
+inline string ToString(OutputFormat format) {
+  return output_format_name[format];
+}
+
+// One row of a result table. Every field has a machine readable value for
+// JSON/CSV and a human readable one for the Markdown table.
+struct ResultRow {
+  string table;
+  vector<string> names;
+  vector<string> values;
+  vector<string> displays;
+  vector<bool> numeric;
+
+  explicit ResultRow(const string &table_name) : table(table_name) {}
+
+  void AddText(const string &name, const string &value);
+  void AddCount(const string &name, uintmax_t value);
+  void AddNumber(const string &name, double value, int precision = 2);
+  // bytes, displayed like 1.20MB
+  void AddSize(const string &name, uintmax_t size);
+  void AddSeconds(const string &name, const timespec &time);
+  // a number that wasn't measured: null in JSON/CSV, "-" in the table
+  void AddMissing(const string &name);
+};
+
+// Prints every row as a Markdown table as soon as it is added, and keeps all
+// rows to write them as JSON or CSV at the end of the run.
+class ResultWriter {
+public:
+  ResultWriter(OutputFormat format = kTableOutput, const string &path = "");
+
+  // The following rows belong to this data set
+  void BeginDataSet(const string &dataset);
+  // The rows of a table are printed together when the table ends, so every
+  // column is as wide as its longest cell
+  void Add(const ResultRow &row);
+  // Print the rows of the current table. Add() of another table,
+  // BeginDataSet() and Finish() end it as well; call it before printing
+  // anything else after a table, like the caption of the next one.
+  void EndTable();
+  // Write the JSON/CSV file. Returns false if it can't be written.
+  bool Finish();
+
+private:
+  void PrintTable();
+  void WriteJson(ostream &os);
+  void WriteCsv(ostream &os);
+
+  const OutputFormat format_;
+  const string path_;
+  string dataset_;
+  string last_table_;
+  // the rows of last_table_ that are not printed yet
+  vector<ResultRow> table_rows_;
+  vector<string> datasets_;
+  vector<ResultRow> rows_;
+};
+
+struct Statistics {
+  string method;
+  // time spent inside the compress/uncompress calls, summed over threads
+  timespec compressed_time{};
+  timespec uncompressed_time{};
+  // wall clock time of the whole row
+  timespec wall_time{};
+  HumanReadable original_size{};
+  HumanReadable compressed_size{};
+  size_t compress_fail = 0;
+  size_t compress_success = 0;
+  size_t uncompress_fail = 0;
+  // hardware counters of the compress/uncompress calls, see --perf-counters
+  PerfCounts compress_counts;
+  PerfCounts uncompress_counts;
+  // load balance of the parallel stages of the row: the busy time of the
+  // workers, and of the busiest worker of every stage, summed over the stages
+  size_t workers = 0;
+  timespec busy_time{};
+  timespec max_busy_time{};
+  // tasks run by another worker than the one of their hint
+  size_t steals = 0;
+
+  // Add up the statistics of another thread
+  void Merge(const Statistics &other);
+  // Add the busy time of every worker of one parallel stage
+  void AddWorkerBusyTimes(const vector<timespec> &busy_times);
+  ResultRow ToRow() const;
+};
+
+// Storage needed by all records of the data set when the records that can't
+// be delta compressed fall back to LZ compression, otherwise stored raw.
+struct StorageStatistics {
+  string method;
+  size_t delta_records = 0;
+  size_t self_records = 0;
+  size_t raw_records = 0;
+  HumanReadable delta_size{};
+  HumanReadable self_size{};
+  HumanReadable raw_size{};
+  HumanReadable original_size{};
+
+  ResultRow ToRow() const;
+};
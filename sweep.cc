@@ -0,0 +1,53 @@
+#include "sweep.h"
+#include "benchmark_options.h"
+#include <unordered_set>
+
+ResultRow SweepResult::ToRow() const {
+  ResultRow row("sweep");
+  row.AddText("detector", ToString(parameters.detector));
+  row.AddText("sample mask", parameters.detector == kOdess
+                                 ? SampleMaskName(parameters.sample_mask)
+                                 : "-");
+  row.AddCount("features", parameters.feature_number);
+  row.AddCount("super features", parameters.super_feature_number);
+  row.AddCount("max scan bytes", parameters.max_scan_bytes);
+  row.AddCount("candidates", candidate_records);
+  row.AddCount("delta records", delta_keys.size());
+  row.AddNumber("recall", recall, 3);
+  row.AddNumber("index bytes/record", index_bytes_per_record, 1);
+  row.AddNumber("feature MB/s", feature_throughput);
+  row.AddNumber("delta ratio", delta_ratio, 3);
+  row.AddText("pareto", pareto ? "yes" : "no");
+  return row;
+}
+
+// a is at least as good as b in every objective and better in one
+static bool Dominates(const SweepResult &a, const SweepResult &b) {
+  bool not_worse = a.delta_ratio >= b.delta_ratio &&
+                   a.feature_throughput >= b.feature_throughput &&
+                   a.index_bytes_per_record <= b.index_bytes_per_record;
+  bool better = a.delta_ratio > b.delta_ratio ||
+                a.feature_throughput > b.feature_throughput ||
+                a.index_bytes_per_record < b.index_bytes_per_record;
+  return not_worse && better;
+}
+
+void EvaluateSweep(vector<SweepResult> &results) {
+  unordered_set<string> all_delta_keys;
+  for (const SweepResult &result : results)
+    all_delta_keys.insert(result.delta_keys.begin(), result.delta_keys.end());
+
+  for (SweepResult &result : results) {
+    result.recall = all_delta_keys.empty()
+                        ? 0
+                        : (double)result.delta_keys.size() /
+                              all_delta_keys.size();
+    result.pareto = true;
+    for (const SweepResult &other : results) {
+      if (Dominates(other, result)) {
+        result.pareto = false;
+        break;
+      }
+    }
+  }
+}
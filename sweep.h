@@ -0,0 +1,38 @@
+#pragma once
+#include "odess_similarity_detection.h"
+#include "statistics.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// How one detector with one combination of the parameters does on a data set
+struct SweepResult {
+  FeatureParameters parameters;
+
+  // records that have a similar record in the feature index
+  size_t candidate_records = 0;
+  // records that are delta compressed with a good ratio
+  vector<string> delta_keys;
+  // bytes of the feature index per record
+  double index_bytes_per_record = 0;
+  // MB/s of FeatureIndexTable::Put
+  double feature_throughput = 0;
+  // all records to all records stored, the records without a good delta are
+  // stored as they are
+  double delta_ratio = 0;
+
+  // set by EvaluateSweep()
+  double recall = 0;
+  bool pareto = false;
+
+  // table "sweep"
+  ResultRow ToRow() const;
+};
+
+// Recall is the share of the records delta compressed by any of the results
+// that a result delta compresses. A result is on the Pareto frontier if no
+// other result is at least as good in delta ratio, feature throughput and
+// index memory and better in one of them.
+void EvaluateSweep(vector<SweepResult> &results);
@@ -0,0 +1,137 @@
+#include "synthetic_data.h"
+#include <algorithm>
+#include <cstdio>
+
+static const size_t kVocabularySize = 4096;
+static const size_t kMaxWordLength = 10;
+static const size_t kWordsPerSentence = 12;
+
+SyntheticDataGenerator::SyntheticDataGenerator(
+    const SyntheticDataOptions &options)
+    : options_(options), state_(options.seed) {
+  words_.resize(kVocabularySize);
+  for (string &word : words_) {
+    size_t length = 2 + Uniform(kMaxWordLength - 1);
+    for (size_t i = 0; i < length; ++i)
+      word.push_back('a' + Uniform(26));
+  }
+}
+
+uint64_t SyntheticDataGenerator::Random() {
+  uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+uint64_t SyntheticDataGenerator::Uniform(uint64_t n) {
+  return (uint64_t)(((unsigned __int128)Random() * n) >> 64);
+}
+
+size_t SyntheticDataGenerator::RecordSize() {
+  const size_t min_size = max<size_t>(options_.min_record_size, 1);
+  const size_t max_size = max(options_.max_record_size, min_size);
+  switch (options_.size_distribution) {
+  case kUniformSize:
+    return min_size + Uniform(max_size - min_size + 1);
+  case kLogUniformSize: {
+    size_t octaves = 1;
+    while ((min_size << octaves) <= max_size)
+      ++octaves;
+    size_t low = min_size << Uniform(octaves);
+    size_t high = min(low * 2 - 1, max_size);
+    return low + Uniform(high - low + 1);
+  }
+  case kFixedSize:
+  default:
+    return min_size;
+  }
+}
+
+// Words from a fixed vocabulary with sentence breaks, so the records compress
+// about as well as natural text.
+void SyntheticDataGenerator::AppendText(size_t size, string *text) {
+  const size_t end = text->size() + size;
+  size_t words = 0;
+  while (text->size() < end) {
+    text->append(words_[Uniform(kVocabularySize)]);
+    if (++words % kWordsPerSentence == 0)
+      text->append(Uniform(4) ? ". " : ".\n");
+    else
+      text->push_back(' ');
+  }
+  text->resize(end);
+}
+
+void SyntheticDataGenerator::Mutate(string *value) {
+  const uint32_t total_weight = options_.insert_weight +
+                                options_.delete_weight +
+                                options_.replace_weight + options_.shift_weight;
+  if (total_weight == 0 || options_.max_edit_length == 0)
+    return;
+
+  // The expected number of edits is edit_rate * size / average edit length.
+  // The fraction is rounded up with the matching probability.
+  double expected = options_.edit_rate * value->size() /
+                    ((options_.max_edit_length + 1) / 2.);
+  size_t edits = (size_t)expected;
+  if (Uniform(1 << 20) < (expected - edits) * (1 << 20))
+    ++edits;
+
+  string text;
+  for (size_t i = 0; i < edits; ++i) {
+    size_t length = 1 + Uniform(options_.max_edit_length);
+    size_t pos = Uniform(value->size() + 1);
+    uint32_t kind = Uniform(total_weight);
+
+    if (kind < options_.insert_weight) {
+      text.clear();
+      AppendText(length, &text);
+      value->insert(pos, text);
+      continue;
+    }
+    kind -= options_.insert_weight;
+    if (kind < options_.delete_weight) {
+      // keep at least one byte, an empty record can't be delta compressed
+      value->erase(pos, min(length, value->size() - 1));
+      continue;
+    }
+    kind -= options_.delete_weight;
+    if (kind < options_.replace_weight) {
+      text.clear();
+      AppendText(length, &text);
+      value->replace(pos, length, text);
+      continue;
+    }
+    string block = value->substr(pos, length * 4);
+    value->erase(pos, block.size());
+    value->insert(Uniform(value->size() + 1), block);
+  }
+}
+
+bool SyntheticDataGenerator::Next(string *key, string *value) {
+  if (generated_ == options_.record_number)
+    return false;
+
+  if (member_ == 0) {
+    base_.clear();
+    AppendText(RecordSize(), &base_);
+    *value = base_;
+  } else {
+    *value = options_.chain_variants ? previous_ : base_;
+    Mutate(value);
+  }
+  previous_ = *value;
+
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "synthetic_%08zu_%04zu", cluster_,
+           member_);
+  key->assign(buffer);
+
+  ++generated_;
+  if (++member_ >= max<size_t>(options_.cluster_size, 1)) {
+    member_ = 0;
+    ++cluster_;
+  }
+  return true;
+}
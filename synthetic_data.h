@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+enum RecordSizeDistribution : uint8_t {
+  kFixedSize,      // every base record has min_record_size bytes
+  kUniformSize,    // uniform in [min_record_size, max_record_size]
+  kLogUniformSize, // each power of two in the range is equally likely
+  kNumberOfRecordSizeDistribution
+};
+
+const static string size_distribution_name[kNumberOfRecordSizeDistribution]{
+    "fixed", "uniform", "log-uniform"};
+
+inline string ToString(RecordSizeDistribution distribution) {
+  return size_distribution_name[distribution];
+}
+
+// The synthetic corpus is made of similarity clusters. Each cluster has a
+// base record of text-like content and cluster_size - 1 variants of it. A
+// variant is the previous record of the cluster (like a new revision of a
+// document) or the base itself, with random edits applied.
+//
+// The same options always generate the same records, on every platform.
+struct SyntheticDataOptions {
+  uint64_t seed = 0x7fcaf1;
+  size_t record_number = 10000;
+  RecordSizeDistribution size_distribution = kLogUniformSize;
+  size_t min_record_size = 64;
+  size_t max_record_size = 64 * 1024;
+  // records in a similarity cluster, including the base
+  size_t cluster_size = 8;
+  // true: a variant is edited from the previous record of the cluster
+  // false: every variant is edited from the base
+  bool chain_variants = true;
+  // expected fraction of bytes touched by edits in every variant
+  double edit_rate = 0.02;
+  size_t max_edit_length = 32;
+  // relative frequency of each kind of edit
+  uint32_t insert_weight = 1;
+  uint32_t delete_weight = 1;
+  uint32_t replace_weight = 1;
+  // move a block of 4 * edit length bytes to another position
+  uint32_t shift_weight = 1;
+};
+
+class SyntheticDataGenerator {
+public:
+  explicit SyntheticDataGenerator(const SyntheticDataOptions &options);
+
+  // Returns false after options.record_number records are generated
+  bool Next(string *key, string *value);
+
+private:
+  // splitmix64, so the sequence doesn't depend on the standard library
+  uint64_t Random();
+  // uniform in [0, n)
+  uint64_t Uniform(uint64_t n);
+  size_t RecordSize();
+  void AppendText(size_t size, string *text);
+  void Mutate(string *value);
+
+  const SyntheticDataOptions options_;
+  uint64_t state_;
+  vector<string> words_;
+  size_t generated_ = 0;
+  size_t cluster_ = 0;
+  size_t member_ = 0;
+  string base_;
+  string previous_;
+};
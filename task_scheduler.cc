@@ -0,0 +1,74 @@
+#include "task_scheduler.h"
+#include "statistics.h"
+
+#include <thread>
+
+WorkStealingScheduler::WorkStealingScheduler(size_t workers)
+    : queues_(new Queue[max<size_t>(workers, 1)]),
+      loads_(max<size_t>(workers, 1)) {}
+
+void WorkStealingScheduler::Submit(size_t hint, Task task) {
+  queues_[hint % Workers()].tasks.push_back(move(task));
+}
+
+bool WorkStealingScheduler::Pop(size_t worker, Task *task) {
+  Queue &queue = queues_[worker];
+  lock_guard<mutex> lock(queue.lock);
+  if (queue.tasks.empty())
+    return false;
+  *task = move(queue.tasks.back());
+  queue.tasks.pop_back();
+  return true;
+}
+
+// Try the other workers in turn, starting from the next one
+bool WorkStealingScheduler::Steal(size_t thief, Task *task) {
+  for (size_t i = 1; i < Workers(); ++i) {
+    Queue &queue = queues_[(thief + i) % Workers()];
+    lock_guard<mutex> lock(queue.lock);
+    if (queue.tasks.empty())
+      continue;
+    *task = move(queue.tasks.front());
+    queue.tasks.pop_front();
+    return true;
+  }
+  return false;
+}
+
+void WorkStealingScheduler::Work(size_t worker,
+                                 const function<void(size_t)> &start,
+                                 const function<void(size_t)> &stop) {
+  struct timespec begin, end;
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+  if (start)
+    start(worker);
+  WorkerLoad &load = loads_[worker];
+  // no task queues new tasks, so the work is done once all queues are empty
+  Task task;
+  for (;;) {
+    if (Pop(worker, &task)) {
+      task(worker);
+    } else if (Steal(worker, &task)) {
+      ++load.steals;
+      task(worker);
+    } else {
+      break;
+    }
+    ++load.tasks;
+  }
+  if (stop)
+    stop(worker);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  AddElapsedTime(load.busy_time, begin, end);
+}
+
+void WorkStealingScheduler::Run(const function<void(size_t)> &start,
+                                const function<void(size_t)> &stop) {
+  vector<thread> workers;
+  for (size_t w = 1; w < Workers(); ++w)
+    workers.emplace_back(&WorkStealingScheduler::Work, this, w, cref(start),
+                         cref(stop));
+  Work(0, start, stop);
+  for (thread &worker : workers)
+    worker.join();
+}
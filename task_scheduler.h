@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+enum SchedulerType : uint8_t {
+  kStaticScheduler,   // ParallelFor() over the base groups, round-robin
+  kStealingScheduler, // a WorkStealingScheduler task per pair
+  kNumberOfScheduler
+};
+
+const static string scheduler_name[kNumberOfScheduler]{"static", "stealing"};
+
+inline string ToString(SchedulerType type) { return scheduler_name[type]; }
+
+// Load of one worker in a WorkStealingScheduler::Run()
+struct WorkerLoad {
+  size_t tasks = 0;
+  // tasks taken from the queues of other workers
+  size_t steals = 0;
+  // from the start of the worker until it finds no task left
+  timespec busy_time{};
+};
+
+// Runs tasks on a fixed number of workers, each with its own queue. A task is
+// queued on the worker of its locality hint, e.g. the base it is compressed
+// against, and every worker runs its queue from the back, so the tasks of one
+// hint run one after another on one core while their base is in its cache.
+// An idle worker steals from the front of the queue of another worker, the
+// tasks its owner would run last, so skewed hints don't leave cores idle.
+class WorkStealingScheduler {
+public:
+  typedef function<void(size_t worker)> Task;
+
+  explicit WorkStealingScheduler(size_t workers);
+
+  size_t Workers() const { return loads_.size(); }
+
+  // Queue task, before Run()
+  void Submit(size_t hint, Task task);
+
+  // Run all queued tasks, worker 0 on the calling thread and the others on
+  // new threads, and return when they are done. start(worker) and
+  // stop(worker) run on the thread of every worker around its tasks.
+  void Run(const function<void(size_t)> &start,
+           const function<void(size_t)> &stop);
+
+  const vector<WorkerLoad> &Loads() const { return loads_; }
+
+private:
+  struct Queue {
+    mutex lock;
+    deque<Task> tasks;
+  };
+
+  bool Pop(size_t worker, Task *task);
+  bool Steal(size_t thief, Task *task);
+  void Work(size_t worker, const function<void(size_t)> &start,
+            const function<void(size_t)> &stop);
+
+  unique_ptr<Queue[]> queues_;
+  vector<WorkerLoad> loads_;
+};
@@ -55,4 +55,35 @@ inline bool GetVarint32(string* input, uint32_t* value) {
     *input = string(q, static_cast<size_t>(limit - q));
     return true;
   }
-}
\ No newline at end of file
+}
+
+inline void EncodeFixed64(char* buf, uint64_t value) {
+  if (kLittleEndian) {
+    memcpy(buf, &value, sizeof(value));
+  } else {
+    for (int i = 0; i < 8; ++i) {
+      buf[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+  }
+}
+
+inline uint64_t DecodeFixed64(const char* ptr) {
+  if (kLittleEndian) {
+    uint64_t result;
+    memcpy(&result, ptr, sizeof(result));
+    return result;
+  } else {
+    uint64_t result = 0;
+    for (int i = 0; i < 8; ++i) {
+      result |= static_cast<uint64_t>(static_cast<unsigned char>(ptr[i]))
+                << (8 * i);
+    }
+    return result;
+  }
+}
+
+inline void PutFixed64(std::string* dst, uint64_t value) {
+  char buf[sizeof(value)];
+  EncodeFixed64(buf, value);
+  dst->append(buf, sizeof(buf));
+}